@@ -14,7 +14,7 @@ void AC_City::initializeCity()
 {
     districtList.Push(true);
     for (int32 i=1; i<7; i++) {
-        int32 current=gameManager->getNeighbor(gameManager->getX(position), gameManager->getY(position), i);
+        int32 current=gameManager->getNeighbor(position, i);
         if (current != -1) {
             workableTiles.Push(current);
             workedTiles.Push(false);
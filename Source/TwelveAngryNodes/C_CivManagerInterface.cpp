@@ -23,80 +23,10 @@ int32 AC_CivManagerInterface::getY(int32 i){
     return (i / mapsizex);
 }
 
-//From a position on the hex grid x and y, returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright
-//Assumes a cylinder wrap, and so uses the xy notation for simplicity of finding special cases
-//Returns -1 if out of map or if dir is 0 or less
-//If dir is bigger than 6, subtracts 6 from dir and calls itself with new dir; if smaller than 1, adds 6 to dir and calls itself with new dir
-int32 AC_CivManagerInterface::getNeighbor(int32 x, int32 y, int32 dir) {
-    int32 ArrayPos=x+y*mapsizex;
-    switch (dir) {
-        case 1://going right
-            if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            else{
-                ArrayPos++;
-            }
-            break;
-        case 2://going topright
-            if (y==(mapsizey-1)) {
-                ArrayPos=-1; //going out top
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex;
-            }
-            break;
-        case 3://going topleft
-            if (y==(mapsizey-1)){
-                ArrayPos=-1; //going out top
-            }
-            else if (x==0) {
-                ArrayPos=ArrayPos+2*mapsizex-1;
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            break;
-        case 4://going left
-            if (x==0) {
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            else{
-                ArrayPos--;
-            }
-            break;
-        case 5://going botleft
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else{
-                ArrayPos=ArrayPos-mapsizex;
-            }
-            break;
-        case 6://going botright
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-2*mapsizex+1;
-            }
-            else {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            break;
-        default:
-            if (dir>6) {
-                return getNeighbor(x, y, dir-6);
-            }
-            else if (dir<1) {
-                return getNeighbor(x, y, dir+6);
-            }
-            else {
-                ArrayPos=-1;
-            }
-            break;
-    }
-    return ArrayPos;
+//Returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright; returns -1 if out of map
+//Looks up the neighbor table shared by the game manager
+int32 AC_CivManagerInterface::getNeighbor(int32 index, int32 dir) {
+    return NeighborTable->getNeighbor(index, dir);
 }
 
 //Moves along stocked path; if path is empty, stops moving. Updates position of unit in all useful arrays and then returns new position of unit.
@@ -106,7 +36,7 @@ int32 AC_CivManagerInterface::moveAlongPath(int32 unitIndex)
         CivUnitList[unitIndex]->position=CivUnitList[unitIndex]->currentpath[1];
         int32 i=1;
         for (; i<7; i++) {
-            if (CivUnitList[unitIndex]->currentpath[1] == getNeighbor(getX(CivUnitList[unitIndex]->currentpath[0]), getY(CivUnitList[unitIndex]->currentpath[0]), i)) {
+            if (CivUnitList[unitIndex]->currentpath[1] == getNeighbor(CivUnitList[unitIndex]->currentpath[0], i)) {
                 break;
             }
         }
@@ -126,8 +56,8 @@ float AC_CivManagerInterface::getMovementCost(int32 source, int32 destination, i
         return -1;
     }
     else {
-        if (TerrainType[source]==ETerrain::VE_Coast) { //Going from sea
-            if (TerrainType[destination]==ETerrain::VE_Coast) { //to sea
+        if (SeenTiles.getTerrain(source)==ETerrain::VE_Coast) { //Going from sea
+            if (SeenTiles.getTerrain(destination)==ETerrain::VE_Coast) { //to sea
                 cost=1.01;
             }
             else { //to land
@@ -135,52 +65,21 @@ float AC_CivManagerInterface::getMovementCost(int32 source, int32 destination, i
             }
         }
         else { //Going from land
-            if (TerrainType[destination]==ETerrain::VE_Coast) { //to sea
+            if (SeenTiles.getTerrain(destination)==ETerrain::VE_Coast) { //to sea
                 return -1;
             }
-            else if (FMath::Max(AltitudeMap[source]-AltitudeMap[destination], AltitudeMap[destination]-AltitudeMap[source])<=1) { //to same altitude or through ramp
+            else if (FMath::Abs(SeenTiles.getAltitude(source)-SeenTiles.getAltitude(destination))<=1) { //to same altitude or through ramp
                 cost=1.01;
             }
             else { //through cliff
                 return -1;
             }
         }
-        if (Forests[destination]!=0) {
+        if (SeenTiles.getForest(destination)!=0) {
             cost=cost+1.01;
         }
-        switch (direction) {
-            case 1:
-                if (GameManager->RiverOn1[source]!=0) {
-                    cost=50;
-                }
-                break;
-            case 2:
-                if (GameManager->RiverOn2[source]!=0) {
-                    cost=50;
-                }
-                break;
-            case 3:
-                if (GameManager->RiverOn2[source]!=0) {
-                    cost=50;
-                }
-                break;
-            case 4:
-                if (GameManager->RiverOn4[source]!=0) {
-                    cost=50;
-                }
-                break;
-            case 5:
-                if (GameManager->RiverOn5[source]!=0) {
-                    cost=50;
-                }
-                break;
-            case 6:
-                if (GameManager->RiverOn6[source]!=0) {
-                    cost=50;
-                }
-                break;
-            default:
-                break;
+        if ((direction >= 1) && (direction <= 6) && SeenTiles.IsRiverOn(source, direction)) {//crossing a river
+            cost=50;
         }
     }
     
@@ -251,7 +150,7 @@ bool AC_CivManagerInterface::findBestPath(int32 from, int32 to, float moves_left
             break;
         }
         for (int j=1; j<7; j++) {
-            int32 actualNeighbor = getNeighbor(getX(current->value), getY(current->value), j);
+            int32 actualNeighbor = getNeighbor(current->value, j);
             float new_cost = getMovementCost(current->value, actualNeighbor, j);
             if (new_cost > -0.5) {
                 int32 new_turns;
@@ -292,21 +191,21 @@ bool AC_CivManagerInterface::findBestPath(int32 from, int32 to, float moves_left
 
 //Updates features on a given hex in this instance of the civ manager, the game manager and in the appropriate C_HexTile; subsequently calculates new yields
 void AC_CivManagerInterface::UpdateHexFeats(int32 position, int32 inForest, EImprovement inImprovement) {
-    Forests[position]=inForest;
-    Improvements[position]=inImprovement;
+    SeenTiles.setForest(position, inForest);
+    SeenTiles.setImprovement(position, inImprovement);
     
-    GameManager->Forests[position]=inForest;
-    GameManager->Improvements[position]=inImprovement;
+    GameManager->setForest(position, inForest);
+    GameManager->setImprovement(position, inImprovement);
     
     GameManager->PrimaryHexArray[position]->hasForest=inForest;
     GameManager->PrimaryHexArray[position]->improvementType=inImprovement;
     GameManager->PrimaryHexArray[position]->CalcTileYields();
-    if (GameManager->hasPositiveTwin[position]) {
+    if (GameManager->TileStore->hasPositiveTwin(position)) {
         GameManager->PositiveTwinHexArray[position]->hasForest=inForest;
         GameManager->PositiveTwinHexArray[position]->improvementType=inImprovement;
         GameManager->PositiveTwinHexArray[position]->CalcTileYields();
     }
-    if (GameManager->hasNegativeTwin[position]) {
+    if (GameManager->TileStore->hasNegativeTwin(position)) {
         GameManager->NegativeTwinHexArray[position]->hasForest=inForest;
         GameManager->NegativeTwinHexArray[position]->improvementType=inImprovement;
         GameManager->NegativeTwinHexArray[position]->CalcTileYields();
@@ -315,16 +214,16 @@ void AC_CivManagerInterface::UpdateHexFeats(int32 position, int32 inForest, EImp
 
 //Sets hasCityFromCiv and cityIDfromCiv C_HexTile variables in appropriate hexes, then calls UpdateHexFeatures to remove forests or improvements on tile and recalculate yields
 void AC_CivManagerInterface::PlaceNewCity(int32 position, int32 cityID) {
-    CityDistricts[position]=playerID;
-    GameManager->CityDistricts[position]=playerID;
+    SeenTiles.setCityOwner(position, playerID);
+    GameManager->setCityOwner(position, playerID);
 
     GameManager->PrimaryHexArray[position]->hasCityDistrictFromCiv=playerID;
     GameManager->PrimaryHexArray[position]->cityIDfromCiv=CivCityList.Num();
-    if (GameManager->hasPositiveTwin[position]) {
+    if (GameManager->TileStore->hasPositiveTwin(position)) {
         GameManager->PositiveTwinHexArray[position]->hasCityDistrictFromCiv=playerID;
         GameManager->PositiveTwinHexArray[position]->cityIDfromCiv=CivCityList.Num();
     }
-    if (GameManager->hasNegativeTwin[position]) {
+    if (GameManager->TileStore->hasNegativeTwin(position)) {
         GameManager->NegativeTwinHexArray[position]->hasCityDistrictFromCiv=playerID;
         GameManager->NegativeTwinHexArray[position]->cityIDfromCiv=CivCityList.Num();
     }
@@ -341,7 +240,7 @@ void AC_CivManagerInterface::PlaceNewCity(int32 position, int32 cityID) {
 //Places a new improvement on given tile position
 void AC_CivManagerInterface::PlaceNewImprovement(int32 position, EImprovement inImprovement) {
     if ((inImprovement == EImprovement::VE_Lumbermill) || (inImprovement == EImprovement::VE_Camp) || (inImprovement == EImprovement::VE_None)) {
-        UpdateHexFeats(position, Forests[position], inImprovement);
+        UpdateHexFeats(position, SeenTiles.getForest(position), inImprovement);
     }
     else {
         UpdateHexFeats(position, 0, inImprovement);
@@ -353,7 +252,7 @@ void AC_CivManagerInterface::PlaceNewImprovement(int32 position, EImprovement in
 
 //Checks if the given position is a legit razing spot, i.e. if it has an improvement.
 bool AC_CivManagerInterface::CheckIfLegitRazeSpot(int32 position) {
-    if (GameManager->Improvements[position] != EImprovement::VE_None) {
+    if (GameManager->TileStore->getImprovement(position) != EImprovement::VE_None) {
         return true;
     }
     return false;
@@ -361,37 +260,17 @@ bool AC_CivManagerInterface::CheckIfLegitRazeSpot(int32 position) {
 
 //Checks if the given position is a legit quarry spot, i.e. if it has a quarry resource of if it's near to a cliff. Also sets a correct rotation to the corresponding hexes.
 bool AC_CivManagerInterface::CheckIfLegitQuarrySpot(int32 position) {
-    if ((GameManager->Resources[position] == EResource::VE_Granite) || (GameManager->Resources[position] == EResource::VE_Limestone) || (GameManager->Resources[position] == EResource::VE_Marble) || (GameManager->Resources[position] == EResource::VE_Salt) || (GameManager->Resources[position] == EResource::VE_Slate)) {
+    EResource resource=GameManager->TileStore->getResource(position);
+    if ((resource == EResource::VE_Granite) || (resource == EResource::VE_Limestone) || (resource == EResource::VE_Marble) || (resource == EResource::VE_Salt) || (resource == EResource::VE_Slate)) {
         return true;
     }
-    if (GameManager->AltitudeMap[position] == 0) {
+    if (GameManager->TileStore->getAltitude(position) == 0) {
         bool legitQuarrySpot=false;
         for (int32 j=1; j<7; j++) {
-            int32 current = getNeighbor(getX(position), getY(position), j);
+            int32 current = getNeighbor(position, j);
             if (current != -1) {
-                if (AltitudeMap[current] == 2) {
-                    switch (j) {
-                        case 1:
-                            if (GameManager->RiverOn1[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        case 2:
-                            if (GameManager->RiverOn2[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        case 3:
-                            if (GameManager->RiverOn3[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        case 4:
-                            if (GameManager->RiverOn4[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        case 5:
-                            if (GameManager->RiverOn5[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        case 6:
-                            if (GameManager->RiverOn6[position] == 0) {legitQuarrySpot=true;}
-                            break;
-                        default:
-                            break;
-                    }
+                if ((SeenTiles.getAltitude(current) == 2) && !SeenTiles.IsRiverOn(position, j)) {
+                    legitQuarrySpot=true;
                 }
             }
         }
@@ -399,84 +278,18 @@ bool AC_CivManagerInterface::CheckIfLegitQuarrySpot(int32 position) {
             bool rotationFound = false;
             while (!rotationFound) {
                 int32 randres=FMath::RandRange(1, 6);
-                int32 current = getNeighbor(getX(position), getY(position), randres);
+                int32 current = getNeighbor(position, randres);
                 if (current != -1) {
-                    if (AltitudeMap[current] == 2) {
-                        switch (randres) {
-                            case 1:
-                                if (GameManager->RiverOn1[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=0;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=0;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=0;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            case 2:
-                                if (GameManager->RiverOn2[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=1;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=1;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=1;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            case 3:
-                                if (GameManager->RiverOn3[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=2;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=2;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=2;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            case 4:
-                                if (GameManager->RiverOn4[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=3;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=3;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=3;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            case 5:
-                                if (GameManager->RiverOn5[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=4;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=4;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=4;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            case 6:
-                                if (GameManager->RiverOn6[position] == 0) {
-                                    GameManager->PrimaryHexArray[position]->resourceRotation=5;
-                                    if (GameManager->hasNegativeTwin[position] == true) {
-                                        GameManager->NegativeTwinHexArray[position]->resourceRotation=5;
-                                    }
-                                    if (GameManager->hasPositiveTwin[position] == true) {
-                                        GameManager->PositiveTwinHexArray[position]->resourceRotation=5;
-                                    }
-                                    rotationFound=true;
-                                }
-                                break;
-                            default:
-                                break;
+                    if (SeenTiles.getAltitude(current) == 2) {
+                        if (!SeenTiles.IsRiverOn(position, randres)) {
+                            GameManager->PrimaryHexArray[position]->resourceRotation=randres-1;
+                            if (GameManager->TileStore->hasNegativeTwin(position)) {
+                                GameManager->NegativeTwinHexArray[position]->resourceRotation=randres-1;
+                            }
+                            if (GameManager->TileStore->hasPositiveTwin(position)) {
+                                GameManager->PositiveTwinHexArray[position]->resourceRotation=randres-1;
+                            }
+                            rotationFound=true;
                         }
                         if (GEngine) {
                             GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("checking if legit cliff quarry spot"));
@@ -492,17 +305,19 @@ bool AC_CivManagerInterface::CheckIfLegitQuarrySpot(int32 position) {
 
 //Checks if the given position is a legit mine spot, i.e. if it has a mine resource.
 bool AC_CivManagerInterface::CheckIfLegitMineSpot(int32 position) {
-    if ((GameManager->Resources[position] == EResource::VE_Copper) || (GameManager->Resources[position] == EResource::VE_Iron) || (GameManager->Resources[position] == EResource::VE_Mithril) || (GameManager->Resources[position] == EResource::VE_Gems) || (GameManager->Resources[position] == EResource::VE_Gold) || (GameManager->Resources[position] == EResource::VE_Silver)) {
+    EResource resource=GameManager->TileStore->getResource(position);
+    if ((resource == EResource::VE_Copper) || (resource == EResource::VE_Iron) || (resource == EResource::VE_Mithril) || (resource == EResource::VE_Gems) || (resource == EResource::VE_Gold) || (resource == EResource::VE_Silver)) {
         return true;
     }
     return false;
 }
 
 bool AC_CivManagerInterface::CheckIfLegitFarmSpot(int32 position) {
-    if ((GameManager->Resources[position] == EResource::VE_Barley) || (GameManager->Resources[position] == EResource::VE_Beans) || (GameManager->Resources[position] == EResource::VE_Corn) || (GameManager->Resources[position] == EResource::VE_Rice) || (GameManager->Resources[position] == EResource::VE_Tomato) || (GameManager->Resources[position] == EResource::VE_Wheat)) {
+    EResource resource=GameManager->TileStore->getResource(position);
+    if ((resource == EResource::VE_Barley) || (resource == EResource::VE_Beans) || (resource == EResource::VE_Corn) || (resource == EResource::VE_Rice) || (resource == EResource::VE_Tomato) || (resource == EResource::VE_Wheat)) {
         return true;
     }
-    if ((GameManager->CheckFreshWaterOnHex(position) != 0) && (TerrainType[position]!=ETerrain::VE_Snow) && (TerrainType[position]!=ETerrain::VE_Hell) && (TerrainType[position]!=ETerrain::VE_Void)) {
+    if ((GameManager->CheckFreshWaterOnHex(position) != 0) && (SeenTiles.getTerrain(position)!=ETerrain::VE_Snow) && (SeenTiles.getTerrain(position)!=ETerrain::VE_Hell) && (SeenTiles.getTerrain(position)!=ETerrain::VE_Void)) {
         return true;
     }
     return false;
@@ -513,22 +328,19 @@ void AC_CivManagerInterface::InitializeCivManagerMapArrays() {
     
     mapsizex=GameManager->mapsizex;
     mapsizey=GameManager->mapsizey;
+    NeighborTable=GameManager->NeighborTable;
     
-    AltitudeMap=TArray<int32>(GameManager->AltitudeMap);
-    TerrainType=TArray<ETerrain>(GameManager->TerrainType);
-    Forests=TArray<int32>(GameManager->Forests);
-    Improvements=TArray<EImprovement>(GameManager->Improvements);
-    CityDistricts=TArray<int32>(GameManager->CityDistricts);
+    SeenTiles=*GameManager->TileStore;
     
     revealedResources=TArray<bool>();
     UndiscoveredResourceTypes=TArray<EResource>();
     revealedResources.SetNum(mapsizex*mapsizey);
     for (int32 i=0; i<(mapsizex*mapsizey); i++) {
-        if (GameManager->Resources[i] == EResource::VE_None) {
+        if (GameManager->TileStore->getResource(i) == EResource::VE_None) {
             revealedResources[i]=false;
         }
         else {
-            if (UndiscoveredResourceTypes.Contains(GameManager->Resources[i])) {
+            if (UndiscoveredResourceTypes.Contains(GameManager->TileStore->getResource(i))) {
                 revealedResources[i]=false;
             }
             else {
@@ -536,4 +348,22 @@ void AC_CivManagerInterface::InitializeCivManagerMapArrays() {
             }
         }
     }
-}
\ No newline at end of file
+}
+//Accessors to the tiles as last seen, for blueprints
+int32 AC_CivManagerInterface::getAltitude(int32 index) {return SeenTiles.getAltitude(index);}
+ETerrain AC_CivManagerInterface::getTerrain(int32 index) {return SeenTiles.getTerrain(index);}
+int32 AC_CivManagerInterface::getForest(int32 index) {return SeenTiles.getForest(index);}
+EImprovement AC_CivManagerInterface::getImprovement(int32 index) {return SeenTiles.getImprovement(index);}
+int32 AC_CivManagerInterface::getCityOwner(int32 index) {return SeenTiles.getCityOwner(index);}
+TArray<int32> AC_CivManagerInterface::getAltitudeMap() {return SeenTiles.UnpackField<int32>(EHexTileField::Altitude);}
+TArray<ETerrain> AC_CivManagerInterface::getTerrainTypeArray() {return SeenTiles.UnpackField<ETerrain>(EHexTileField::Terrain);}
+TArray<int32> AC_CivManagerInterface::getForestArray() {return SeenTiles.UnpackField<int32>(EHexTileField::Forest);}
+TArray<EImprovement> AC_CivManagerInterface::getImprovementArray() {return SeenTiles.UnpackField<EImprovement>(EHexTileField::Improvement);}
+TArray<int32> AC_CivManagerInterface::getCityDistrictArray() {return SeenTiles.UnpackField<int32>(EHexTileField::CityOwner);}
+
+//Changes to the tiles as last seen, for blueprints
+void AC_CivManagerInterface::setAltitude(int32 index, int32 altitude) {SeenTiles.setAltitude(index, altitude);}
+void AC_CivManagerInterface::setTerrain(int32 index, ETerrain terrain) {SeenTiles.setTerrain(index, terrain);}
+void AC_CivManagerInterface::setForest(int32 index, int32 forest) {SeenTiles.setForest(index, forest);}
+void AC_CivManagerInterface::setImprovement(int32 index, EImprovement improvement) {SeenTiles.setImprovement(index, improvement);}
+void AC_CivManagerInterface::setCityOwner(int32 index, int32 owner) {SeenTiles.setCityOwner(index, owner);}
@@ -27,17 +27,9 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
     int32 mapsizey;
     
-    //Possible values : 0, 1, 2, 3. At the end of GenerateTerrainType(), all non zero values get a -1, so that possible values are 0, 1->0, 2->1, 3->2.
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> AltitudeMap;
-    
-    //Terrain map (as last seen)
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<ETerrain> TerrainType;
-    
-    //Forests map : (as last seen)
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> Forests;
+    //Tiles as last seen by this civ (altitude, terrain, forests, rivers, improvements, cities), packed the same way as in the game manager
+    //The only copy of what this civ has seen : blueprints go through the accessors below
+    FHexTileStore SeenTiles;
     
     //Resource map : (as last seen)
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
@@ -45,14 +37,6 @@ public:
     //Short array of all undiscovered resource types; anything in this array not rendered on map
     TArray<EResource> UndiscoveredResourceTypes;
     
-    //Improvement map : (as last seen)
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<EImprovement> Improvements;
-    
-    //Cities map : (as last seen) ; -1 is no city, other values correspond to owning faction
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> CityDistricts;
-    
     //Pathfinding
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Path")
     TArray<int32> currentpath;
@@ -62,6 +46,9 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Manager Reference", Meta=(ExposeOnSpawn=true))
     AC_GameManager* GameManager;
     
+    //Neighbor table shared by the game manager
+    TSharedPtr<FHexNeighborTable> NeighborTable;
+    
     //Player Identifier
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Turn Info", Meta=(ExposeOnSpawn=true))
     int32 playerID;
@@ -116,6 +103,39 @@ public:
     UFUNCTION(BluePrintCallable, Category="Initialization Functions")
     void InitializeCivManagerMapArrays();
     
+    //Accessors to the tiles as last seen
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getAltitude(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    ETerrain getTerrain(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getForest(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    EImprovement getImprovement(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getCityOwner(int32 index);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getAltitudeMap();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<ETerrain> getTerrainTypeArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getForestArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<EImprovement> getImprovementArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getCityDistrictArray();
+    //Changes to the tiles as last seen
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setAltitude(int32 index, int32 altitude);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setTerrain(int32 index, ETerrain terrain);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setForest(int32 index, int32 forest);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setImprovement(int32 index, EImprovement improvement);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setCityOwner(int32 index, int32 owner);
+    
     //Internal functions
     
     float getMovementCost(int32 source, int32 destination, int32 direction);
@@ -124,7 +144,7 @@ public:
     
     int32 getX(int32 i);
     int32 getY(int32 i);
-    int32 getNeighbor(int32 x, int32 y, int32 dir);
+    int32 getNeighbor(int32 index, int32 dir);
 };
 
 
@@ -19,103 +19,55 @@ int32 AC_GameManager::getY(int32 i){
     return (i / mapsizex);
 }
 
+//Returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright; returns -1 if out of map
+//Looks up the neighbor table handed over by the map generator
 int32 AC_GameManager::getNeighbor(int32 index, int32 dir)
 {
-    return getNeighbor(getX(index), getY(index), dir);
+    return NeighborTable->getNeighbor(index, dir);
 }
 
-//From a position on the hex grid x and y, returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright
-//Assumes a cylinder wrap, and so uses the xy notation for simplicity of finding special cases
-//Returns -1 if out of map or if dir is 0 or less
-//If dir is bigger than 6, subtracts 6 from dir and calls itself with new dir; if smaller than 1, adds 6 to dir and calls itself with new dir
-int32 AC_GameManager::getNeighbor(int32 x, int32 y, int32 dir) {
-    int32 ArrayPos=x+y*mapsizex;
-    switch (dir) {
-        case 1://going right
-            if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            else{
-                ArrayPos++;
-            }
-            break;
-        case 2://going topright
-            if (y==(mapsizey-1)) {
-                ArrayPos=-1; //going out top
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex;
-            }
-            break;
-        case 3://going topleft
-            if (y==(mapsizey-1)){
-                ArrayPos=-1; //going out top
-            }
-            else if (x==0) {
-                ArrayPos=ArrayPos+2*mapsizex-1;
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            break;
-        case 4://going left
-            if (x==0) {
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            else{
-                ArrayPos--;
-            }
-            break;
-        case 5://going botleft
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else{
-                ArrayPos=ArrayPos-mapsizex;
-            }
-            break;
-        case 6://going botright
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-2*mapsizex+1;
-            }
-            else {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            break;
-        default:
-            if (dir>6) {
-                return getNeighbor(x, y, dir-6);
-            }
-            else if (dir<1) {
-                return getNeighbor(x, y, dir+6);
-            }
-            else {
-                ArrayPos=-1;
-            }
-            break;
+//Tile accessors, reading the packed tile store
+int32 AC_GameManager::getAltitude(int32 index) {return TileStore->getAltitude(index);}
+ETerrain AC_GameManager::getTerrain(int32 index) {return TileStore->getTerrain(index);}
+int32 AC_GameManager::getForest(int32 index) {return TileStore->getForest(index);}
+EResource AC_GameManager::getResource(int32 index) {return TileStore->getResource(index);}
+EImprovement AC_GameManager::getImprovement(int32 index) {return TileStore->getImprovement(index);}
+int32 AC_GameManager::getCityOwner(int32 index) {return TileStore->getCityOwner(index);}
+bool AC_GameManager::getPositiveTwin(int32 index) {return TileStore->hasPositiveTwin(index);}
+bool AC_GameManager::getNegativeTwin(int32 index) {return TileStore->hasNegativeTwin(index);}
+bool AC_GameManager::IsRiverOn(int32 index, int32 dir) {return TileStore->IsRiverOn(index, dir);}
+bool AC_GameManager::IsNextToRiver(int32 index) {return TileStore->getRiverEdges(index) != 0;}
+
+//Whole map views, for blueprints
+TArray<int32> AC_GameManager::getAltitudeMap() {return TileStore->UnpackField<int32>(EHexTileField::Altitude);}
+TArray<ETerrain> AC_GameManager::getTerrainTypeArray() {return TileStore->UnpackField<ETerrain>(EHexTileField::Terrain);}
+TArray<int32> AC_GameManager::getForestArray() {return TileStore->UnpackField<int32>(EHexTileField::Forest);}
+TArray<EResource> AC_GameManager::getResourceArray() {return TileStore->UnpackField<EResource>(EHexTileField::Resource);}
+TArray<EImprovement> AC_GameManager::getImprovementArray() {return TileStore->UnpackField<EImprovement>(EHexTileField::Improvement);}
+TArray<int32> AC_GameManager::getCityDistrictArray() {return TileStore->UnpackField<int32>(EHexTileField::CityOwner);}
+
+//Rebuilds one of the former per side river arrays : 1 where there is a river on side 'dir' of the tile, 0 otherwise
+TArray<int32> AC_GameManager::getRiverOnArray(int32 dir)
+{
+    TArray<int32> RiverOn;
+    RiverOn.SetNum(TileStore->Num());
+    for (int32 i=0; i<TileStore->Num(); i++) {
+        RiverOn[i]=TileStore->IsRiverOn(i, dir) ? 1 : 0;
     }
-    return ArrayPos;
+    return RiverOn;
 }
 
+//Tile setters, for gameplay changes and blueprints
+void AC_GameManager::setAltitude(int32 index, int32 altitude) {TileStore->setAltitude(index, altitude);}
+void AC_GameManager::setTerrain(int32 index, ETerrain terrain) {TileStore->setTerrain(index, terrain);}
+void AC_GameManager::setForest(int32 index, int32 forest) {TileStore->setForest(index, forest);}
+void AC_GameManager::setResource(int32 index, EResource resource) {TileStore->setResource(index, resource);}
+void AC_GameManager::setImprovement(int32 index, EImprovement improvement) {TileStore->setImprovement(index, improvement);}
+void AC_GameManager::setCityOwner(int32 index, int32 owner) {TileStore->setCityOwner(index, owner);}
+
 //Checks if given hex has fresh water; 0 is no fresh water, 1 is next to lake, 2 is next to river; river overrides lake.
+//Computed once by the map generator (CheckFreshWater) and stored with the tile
 int32 AC_GameManager::CheckFreshWaterOnHex(int32 position)
 {
-    int32 freshWaterType=0;
-    if ((TerrainType[position]!=ETerrain::VE_Coast) || (TerrainType[position]!=ETerrain::VE_Lake) || (TerrainType[position]!=ETerrain::VE_Ocean)) {//if tile is not water, then
-        for (int32 j=1; j<7; j++) {
-            int32 current = getNeighbor(getX(position), getY(position), j);
-            if (current != -1) {
-                if (TerrainType[current] == ETerrain::VE_Lake) {//check if it's next to a lake
-                    freshWaterType=1;
-                }
-            }
-        }
-        if ((RiverOn1[position]==1) || (RiverOn2[position]==1) || (RiverOn3[position]==1) || (RiverOn4[position]==1) || (RiverOn5[position]==1) || (RiverOn6[position]==1)) {//or to a river
-            freshWaterType=2;
-        }
-    }
-    return freshWaterType;
+    return TileStore->getFreshWater(position);
 }
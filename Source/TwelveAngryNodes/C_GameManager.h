@@ -4,6 +4,8 @@
 
 #include "GameFramework/Actor.h"
 #include "C_HexTile.h"
+#include "C_HexGrid.h"
+#include "C_HexTileStore.h"
 #include "C_GameManager.generated.h"
 
 /**
@@ -28,46 +30,9 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
     int32 mapsizey;
     
-    //Possible values : 0, 1, 2, 3. At the end of GenerateTerrainType(), all non zero values get a -1, so that possible values are 0, 1, 2.
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> AltitudeMap;
-    
-    //Terrain types : 0=water, 1=grassland, 2=plain, 3=tundra, 4=snow, 5=desert
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<ETerrain> TerrainType;
-    
-    //Forest types :
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> Forests;
-    
-    //Resource map :
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<EResource> Resources;
-    
-    //Improvement map :
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<EImprovement> Improvements;
-    
-    //Cities map : (as last seen) ; -1 is no city, other values correspond to owning faction
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> CityDistricts;
-    
-    //Rivers
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<bool> hasRiver;
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn1;//right
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn2;//topright
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn3;//topleft
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn4;//left
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn5;//botleft
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn6;//botright
-    
+    //Packed per tile state (altitude, terrain, forests, fresh water, rivers, resources, improvements, cities, twins), handed over by the map generator
+    //The only copy of the map : blueprints go through the tile accessors below
+    TSharedPtr<FHexTileStore> TileStore;
     
     //Array of decent starting spots for civs; may contain more spots than there are civs, but not the contrary
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
@@ -80,10 +45,6 @@ public:
     TArray<AC_HexTile*> PositiveTwinHexArray;
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Hex References")
     TArray<AC_HexTile*> NegativeTwinHexArray;
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Hex References")
-    TArray<bool> hasPositiveTwin;
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Hex References")
-    TArray<bool> hasNegativeTwin;
     
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Path")
     TArray<int32> currentpath;
@@ -96,6 +57,9 @@ public:
     //When true, ends players turn
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Turn Info")
     int32 currentTurn;
+    
+    //Neighbor table shared with the map generator and the civ managers
+    TSharedPtr<FHexNeighborTable> NeighborTable;
 	
     
     
@@ -107,11 +71,62 @@ public:
     UFUNCTION(BluePrintCallable, Category="Access Functions")
     int32 getNeighbor(int32 index, int32 dir);
     
+    //Tile accessors
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getAltitude(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    ETerrain getTerrain(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getForest(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    EResource getResource(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    EImprovement getImprovement(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    int32 getCityOwner(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    bool getPositiveTwin(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    bool getNegativeTwin(int32 index);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    bool IsRiverOn(int32 index, int32 dir);
+    UFUNCTION(BlueprintPure, Category="Access Functions")
+    bool IsNextToRiver(int32 index);
+    
+    //Whole map views, unpacked from the tile store
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getAltitudeMap();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<ETerrain> getTerrainTypeArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getForestArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<EResource> getResourceArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<EImprovement> getImprovementArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getCityDistrictArray();
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    TArray<int32> getRiverOnArray(int32 dir);
+    
+    //Tile setters, writing the packed tile store
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setAltitude(int32 index, int32 altitude);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setTerrain(int32 index, ETerrain terrain);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setForest(int32 index, int32 forest);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setResource(int32 index, EResource resource);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setImprovement(int32 index, EImprovement improvement);
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    void setCityOwner(int32 index, int32 owner);
+    
     int32 CheckFreshWaterOnHex(int32 position);
     
     int32 getX(int32 i);
     int32 getY(int32 i);
-    int32 getNeighbor(int32 x, int32 y, int32 dir);
     
 
     
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_HexGrid.h"
+
+FHexNeighborTable::FHexNeighborTable() : mapsizex(0), mapsizey(0)
+{
+
+}
+
+FHexNeighborTable::FHexNeighborTable(int32 inMapsizex, int32 inMapsizey)
+{
+    Build(inMapsizex, inMapsizey);
+}
+
+//Fills the table row by row; every lookup done afterwards is a single array access
+void FHexNeighborTable::Build(int32 inMapsizex, int32 inMapsizey)
+{
+    mapsizex=inMapsizex;
+    mapsizey=inMapsizey;
+    int32 mapsize=mapsizex*mapsizey;
+    Neighbors.SetNumUninitialized(mapsize*6);
+
+    int32 *current=Neighbors.GetData();
+    for (int32 y=0; y<mapsizey; y++) {
+        for (int32 x=0; x<mapsizex; x++) {
+            for (int32 dir=1; dir<7; dir++) {
+                *current++=ComputeNeighbor(x, y, dir, mapsizex, mapsizey);
+            }
+        }
+    }
+}
+
+//From a position on the hex grid x and y, returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright
+//Assumes a cylinder wrap, and so uses the xy notation for simplicity of finding special cases
+//Returns -1 if out of map or if dir is not in [1,6]
+int32 FHexNeighborTable::ComputeNeighbor(int32 x, int32 y, int32 dir, int32 inMapsizex, int32 inMapsizey)
+{
+    int32 ArrayPos=x+y*inMapsizex;
+    switch (dir) {
+        case 1://going right
+            if (x==(inMapsizex-1)) {
+                ArrayPos=ArrayPos-inMapsizex+1;
+            }
+            else{
+                ArrayPos++;
+            }
+            break;
+        case 2://going topright
+            if (y==(inMapsizey-1)) {
+                ArrayPos=-1; //going out top
+            }
+            else{
+                ArrayPos=ArrayPos+inMapsizex;
+            }
+            break;
+        case 3://going topleft
+            if (y==(inMapsizey-1)){
+                ArrayPos=-1; //going out top
+            }
+            else if (x==0) {
+                ArrayPos=ArrayPos+2*inMapsizex-1;
+            }
+            else{
+                ArrayPos=ArrayPos+inMapsizex-1;
+            }
+            break;
+        case 4://going left
+            if (x==0) {
+                ArrayPos=ArrayPos+inMapsizex-1;
+            }
+            else{
+                ArrayPos--;
+            }
+            break;
+        case 5://going botleft
+            if (y==0) {
+                ArrayPos=-1; //going out bot
+            }
+            else{
+                ArrayPos=ArrayPos-inMapsizex;
+            }
+            break;
+        case 6://going botright
+            if (y==0) {
+                ArrayPos=-1; //going out bot
+            }
+            else if (x==(inMapsizex-1)) {
+                ArrayPos=ArrayPos-2*inMapsizex+1;
+            }
+            else {
+                ArrayPos=ArrayPos-inMapsizex+1;
+            }
+            break;
+        default:
+            ArrayPos=-1;
+            break;
+    }
+    return ArrayPos;
+}
+
+void FHexNeighborTable::PickFarthestTiles(int32 first, int32 count, const TArray<int32>& candidates, TArray<int32>& outTiles) const
+{
+    int32 mapsize=Num();
+    TArray<int32> distances;
+    distances.Init(MAX_int32, mapsize);
+    //A tile gets its exact distance from the new tile the first time it is reached, so it gets in the queue at most once per pick
+    TArray<int32> queue;
+    queue.SetNumUninitialized(mapsize);
+    int32 picked=first;
+    for (int32 n=0; (n<count) && (picked!=-1); n++) {
+        outTiles.Add(picked);
+        distances[picked]=0;
+        queue[0]=picked;
+        int32 tail=1;
+        for (int32 head=0; head<tail; head++) {
+            int32 next=distances[queue[head]]+1;
+            const int32* neighbors=getNeighbors(queue[head]);
+            for (int32 j=0; j<6; j++) {
+                if ((neighbors[j]!=-1) && (distances[neighbors[j]] > next)) {
+                    distances[neighbors[j]]=next;
+                    queue[tail++]=neighbors[j];
+                }
+            }
+        }
+        picked=-1;
+        int32 farthest=0;
+        for (int32 i=0; i<candidates.Num(); i++) {
+            if (distances[candidates[i]] > farthest) {
+                farthest=distances[candidates[i]];
+                picked=candidates[i];
+            }
+        }
+    }
+}
+
+//Seeds go in the queue in their order, so every wave reaches a tile from the first seed able to get there
+void FHexNeighborTable::ComputeNearestSeeds(const TArray<int32>& seeds, TArray<int32>& outLabels) const
+{
+    int32 mapsize=Num();
+    outLabels.Init(-1, mapsize);
+    TArray<int32> queue;
+    queue.SetNumUninitialized(mapsize);
+    int32 tail=0;
+    for (int32 i=0; i<seeds.Num(); i++) {
+        if (outLabels[seeds[i]]==-1) {
+            outLabels[seeds[i]]=i;
+            queue[tail++]=seeds[i];
+        }
+    }
+    for (int32 head=0; head<tail; head++) {
+        int32 label=outLabels[queue[head]];
+        const int32* neighbors=getNeighbors(queue[head]);
+        for (int32 j=0; j<6; j++) {
+            if ((neighbors[j]!=-1) && (outLabels[neighbors[j]]==-1)) {
+                outLabels[neighbors[j]]=label;
+                queue[tail++]=neighbors[j];
+            }
+        }
+    }
+}
+
+//Tiles of the disc of tile (x, y) are (x+dq, y+dr) with dr in [-radius, radius] and dq in [max(-radius, -radius-dr), min(radius, radius-dr)]
+void FHexNeighborTable::SumOverDiscs(const TArray<int32>& values, int32 radius, TArray<int32>& outSums) const
+{
+    int32 w=mapsizex;
+    int32 h=mapsizey;
+    radius=FMath::Clamp(radius, 0, (w-1)/2);
+
+    /*Prefix sums from row 0 along the columns and along the topleft diagonals (which wrap around the cylinder).
+     Rows are padded with 'pad' wrapped columns on both sides, so that the sweep never has to wrap, and an extra row of zeros stands for the sums left out.
+     */
+    int32 pad=radius+1;
+    int32 stride=w+2*pad;
+    TArray<int32> columnSums, diagonalSums;
+    columnSums.SetNumZeroed(stride*(h+1));
+    diagonalSums.SetNumZeroed(stride*(h+1));
+    for (int32 y=0; y<h; y++) {
+        int32* columnRow=columnSums.GetData() + y*stride + pad;
+        int32* diagonalRow=diagonalSums.GetData() + y*stride + pad;
+        const int32* valueRow=values.GetData() + y*w;
+        for (int32 x=0; x<w; x++) {
+            columnRow[x]=valueRow[x] + ((y > 0) ? columnRow[x-stride] : 0);
+            diagonalRow[x]=valueRow[x] + ((y > 0) ? diagonalRow[x+1-stride] : 0);
+        }
+        //The padding of a row is needed by the diagonals of the next one
+        for (int32 x=-pad; x<0; x++) {
+            columnRow[x]=columnRow[x+w];
+            diagonalRow[x]=diagonalRow[x+w];
+        }
+        for (int32 x=w; x<w+pad; x++) {
+            columnRow[x]=columnRow[x-w];
+            diagonalRow[x]=diagonalRow[x-w];
+        }
+    }
+
+    //Offsets of the disc, only walked through for the first tile of every row
+    TArray<FIntPoint> discOffsets;
+    for (int32 dr=-radius; dr<=radius; dr++) {
+        for (int32 dq=FMath::Max(-radius, -radius-dr); dq<=FMath::Min(radius, radius-dr); dq++) {
+            discOffsets.Add(FIntPoint(dq, dr));
+        }
+    }
+
+    outSums.SetNumUninitialized(Num());
+    ParallelFor(h, [this, &values, &outSums, &columnSums, &diagonalSums, &discOffsets, radius, pad, stride, w, h](int32 y) {
+        const int32* columns=columnSums.GetData() + pad;
+        const int32* diagonals=diagonalSums.GetData() + pad;
+        //Row of zeros, standing for the prefix before row 0
+        int32 none=h*stride;
+        auto row=[none, stride](int32 r) {return (r >= 0) ? r*stride : none;};
+
+        //Moving from x to x+1, column x+1+radius comes in on rows y-radius to y, and column x-radius goes out on rows y to y+radius
+        int32 last=FMath::Min(y+radius, h-1);
+        const int32* inColumn=columns + row(y) + 1 + radius;
+        const int32* inColumnBefore=columns + row(y-radius-1) + 1 + radius;
+        const int32* outColumn=columns + row(last) - radius;
+        const int32* outColumnBefore=columns + row(y-1) - radius;
+        //The diagonal from (x+radius, y+1) to row 'last' comes in, and the diagonal from (x, y-radius) to row y-1 goes out
+        const int32* inDiagonal=diagonals + ((last > y) ? row(last) + radius - (last-y-1) : none);
+        const int32* inDiagonalBefore=diagonals + ((last > y) ? row(y) + radius + 1 : none);
+        const int32* outDiagonal=diagonals + (((y > 0) && (radius > 0)) ? row(y-1) - radius + 1 : none);
+        const int32* outDiagonalBefore=diagonals + (((y > 0) && (radius > 0)) ? row(y-radius-1) + 1 : none);
+
+        int32 sum=0;
+        for (int32 k=0; k<discOffsets.Num(); k++) {
+            int32 r=y+discOffsets[k].Y;
+            if ((r >= 0) && (r < h)) {
+                sum+=values[WrapX(discOffsets[k].X) + r*w];
+            }
+        }
+        int32* out=outSums.GetData() + y*w;
+        out[0]=sum;
+        for (int32 x=0; x<w-1; x++) {
+            sum+=(inColumn[x] - inColumnBefore[x]) + (inDiagonal[x] - inDiagonalBefore[x]);
+            sum-=(outColumn[x] - outColumnBefore[x]) + (outDiagonal[x] - outDiagonalBefore[x]);
+            out[x+1]=sum;
+        }
+    });
+}
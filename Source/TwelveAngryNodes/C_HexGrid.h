@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Async/ParallelFor.h"
+
+/**
+ * Precomputed neighbor table for the cylinder wrapped hex map.
+ * Built once per map and shared (through a TSharedPtr) by the map generator, the game manager and the civ managers.
+ */
+class TWELVEANGRYNODES_API FHexNeighborTable
+{
+public:
+
+    //VARIABLES
+
+    int32 mapsizex;
+    int32 mapsizey;
+
+    //FUNCTIONS
+
+    FHexNeighborTable();
+    FHexNeighborTable(int32 inMapsizex, int32 inMapsizey);
+
+    //(Re)builds the table for the given map size
+    void Build(int32 inMapsizex, int32 inMapsizey);
+
+    //Returns the index of the 'dir' neighbor of tile 'index' : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright; returns -1 if out of map
+    //Any dir bigger than -599 is accepted and wrapped around (7 is 1, 0 is 6, etc.)
+    FORCEINLINE int32 getNeighbor(int32 index, int32 dir) const
+    {
+        return Neighbors[index*6 + WrapDirection(dir)];
+    }
+
+    //Same as getNeighbor, but takes a 0 based direction slot (0=right ... 5=botright) which has to be in [0,5]
+    FORCEINLINE int32 getNeighborSlot(int32 index, int32 slot) const
+    {
+        return Neighbors[index*6 + slot];
+    }
+
+    //Returns a pointer to the 6 neighbors of tile 'index', in slot order
+    FORCEINLINE const int32* getNeighbors(int32 index) const
+    {
+        return &Neighbors[index*6];
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return mapsizex*mapsizey;
+    }
+
+    //Brings any direction back to a 0 based slot without branching; 600 is a multiple of 6, so this holds for dir>-599
+    static FORCEINLINE int32 WrapDirection(int32 dir)
+    {
+        return (int32)((uint32)(dir + 599) % 6u);
+    }
+
+    //Bit of the 'dir' side in a tile edge mask (such as river edges); any dir accepted by getNeighbor works
+    static FORCEINLINE uint8 EdgeBit(int32 dir)
+    {
+        return (uint8)(1 << WrapDirection(dir));
+    }
+
+    //Marks the edge between tile 'index' and its 'dir' neighbor in an edge mask array, on both sides of the edge
+    FORCEINLINE void SetEdge(TArray<uint8>& edges, int32 index, int32 dir) const
+    {
+        int32 slot=WrapDirection(dir);
+        edges[index] |= (uint8)(1 << slot);
+        int32 neighbor=Neighbors[index*6 + slot];
+        if (neighbor != -1) {
+            edges[neighbor] |= (uint8)(1 << ((slot+3) % 6));
+        }
+    }
+
+    //Clears the edge between tile 'index' and its 'dir' neighbor in an edge mask array, on both sides of the edge
+    FORCEINLINE void ClearEdge(TArray<uint8>& edges, int32 index, int32 dir) const
+    {
+        int32 slot=WrapDirection(dir);
+        edges[index] &= (uint8)~(1 << slot);
+        int32 neighbor=Neighbors[index*6 + slot];
+        if (neighbor != -1) {
+            edges[neighbor] &= (uint8)~(1 << ((slot+3) % 6));
+        }
+    }
+
+    //Returns the vertex at corner 'dir' of tile 'index' : the corner between its 'dir' and 'dir+1' sides (1=between right and topright ... 6=between botright and right)
+    //Every vertex is shared by three tiles, so there are two per tile : vertex 2*i is corner 1 of tile i, and vertex 2*i+1 its corner 2. Returns -1 if one of the three tiles is out of map
+    FORCEINLINE int32 getCorner(int32 index, int32 dir) const
+    {
+        int32 slot=WrapDirection(dir);
+        const int32* neighbors=getNeighbors(index);
+        if ((neighbors[slot]==-1) || (neighbors[(slot+1)%6]==-1)) {
+            return -1;
+        }
+        //Corner 'dir' of a tile is also corner 'dir+2' of its 'dir' neighbor and corner 'dir+4' of its 'dir+1' neighbor
+        static const int32 OwnerSlot[6]={-1, -1, 3, 4, 4, 5};
+        int32 owner=(slot < 2) ? index : neighbors[OwnerSlot[slot]];
+        return 2*owner + (slot & 1);
+    }
+
+    FORCEINLINE int32 NumCorners() const
+    {
+        return 2*Num();
+    }
+
+    //Reference implementation of the neighbor computation on the cylinder, used to fill the table; dir has to be in [1,6]
+    static int32 ComputeNeighbor(int32 x, int32 y, int32 dir, int32 inMapsizex, int32 inMapsizey);
+
+    /*Labels the connected components of the tiles for which isMember(index) is true, with a single union-find pass over the map.
+     outLabels gets the component of every tile (-1 for non members); components are numbered in order of their lowest tile index.
+     outSizes gets the number of tiles of every component. Returns the number of components.
+     */
+    template<typename PredicateType>
+    int32 LabelComponents(PredicateType isMember, TArray<int32>& outLabels, TArray<int32>& outSizes) const
+    {
+        int32 mapsize=Num();
+        TArray<int32> parents;
+        parents.SetNumUninitialized(mapsize);
+        for (int32 i=0; i<mapsize; i++) {
+            parents[i]=isMember(i) ? i : -1;
+        }
+
+        //Every edge is seen once by only looking right, topright and topleft; roots are always the lowest index of their set
+        for (int32 i=0; i<mapsize; i++) {
+            if (parents[i]==-1) {
+                continue;
+            }
+            const int32* neighbors=getNeighbors(i);
+            for (int32 j=0; j<3; j++) {
+                if ((neighbors[j]!=-1) && (parents[neighbors[j]]!=-1)) {
+                    int32 a=FindRoot(parents, i);
+                    int32 b=FindRoot(parents, neighbors[j]);
+                    if (a<b) {
+                        parents[b]=a;
+                    }
+                    else if (b<a) {
+                        parents[a]=b;
+                    }
+                }
+            }
+        }
+
+        //Roots come before the rest of their set, so one ascending pass is enough to give compact labels
+        outLabels.SetNumUninitialized(mapsize);
+        outSizes.Reset();
+        for (int32 i=0; i<mapsize; i++) {
+            if (parents[i]==-1) {
+                outLabels[i]=-1;
+            }
+            else if (parents[i]==i) {
+                outLabels[i]=outSizes.Add(1);
+            }
+            else {
+                outLabels[i]=outLabels[FindRoot(parents, i)];
+                outSizes[outLabels[i]]++;
+            }
+        }
+        return outSizes.Num();
+    }
+
+    /*Multi-source breadth first search : outDistances gets the number of hops from every tile to the closest tile for which isSeed(index) is true (0 for seeds),
+     or -1 if there is no seed. A single linear pass over the map, whatever the number of seeds. Returns the biggest distance (-1 if there is no seed).
+     */
+    template<typename PredicateType>
+    int32 ComputeDistances(PredicateType isSeed, TArray<int32>& outDistances) const
+    {
+        int32 mapsize=Num();
+        outDistances.SetNumUninitialized(mapsize);
+        //Every tile gets in the queue at most once
+        TArray<int32> queue;
+        queue.SetNumUninitialized(mapsize);
+        int32 tail=0;
+        for (int32 i=0; i<mapsize; i++) {
+            if (isSeed(i)) {
+                outDistances[i]=0;
+                queue[tail++]=i;
+            }
+            else {
+                outDistances[i]=-1;
+            }
+        }
+        for (int32 head=0; head<tail; head++) {
+            int32 current=queue[head];
+            int32 next=outDistances[current]+1;
+            const int32* neighbors=getNeighbors(current);
+            for (int32 j=0; j<6; j++) {
+                if ((neighbors[j]!=-1) && (outDistances[neighbors[j]]==-1)) {
+                    outDistances[neighbors[j]]=next;
+                    queue[tail++]=neighbors[j];
+                }
+            }
+        }
+        return (tail > 0) ? outDistances[queue[tail-1]] : -1;
+    }
+
+    /*Farthest point sampling : outTiles gets 'first', then up to count-1 more tiles of 'candidates', each one as far as possible (in hops) from the ones picked
+     before it, ties going to the first one in the array. Every pick runs a breadth first search from the new tile, cut wherever it stops getting closer.
+     */
+    void PickFarthestTiles(int32 first, int32 count, const TArray<int32>& candidates, TArray<int32>& outTiles) const;
+
+    //Multi-source breadth first search from the tiles of 'seeds' : outLabels gets, for every tile, the position in 'seeds' of the closest one (ties going to the first seed in the array)
+    void ComputeNearestSeeds(const TArray<int32>& seeds, TArray<int32>& outLabels) const;
+
+    /*outSums gets, for every tile, the sum of values over its disc : the tiles at most 'radius' hops away (radius is cut down so that discs fit around the cylinder).
+     Rows are swept from left to right : moving the disc one tile right brings in a column and a topleft diagonal of tiles, and takes out another column
+     and another diagonal, whose sums are read from prefix sums along the columns and the diagonals. Costs 8 lookups per tile, whatever the radius.
+     */
+    void SumOverDiscs(const TArray<int32>& values, int32 radius, TArray<int32>& outSums) const;
+
+    /*Six neighbor stencil : out[i]=kernel(i, values) for every tile i of rows [firstRow, lastRow), values[j] being in[] of the neighbor in slot j, or 'outside' if there is none.
+     Kernels only get neighbor values, not indexes. Inside the map (rows 1 to mapsizey-2, columns 1 to mapsizex-2) the neighbors are at fixed offsets from the tile,
+     so they are read with plain offset loads, which vectorize; the seam columns and the top and bottom rows go through the table.
+     'out' has to hold a value for every tile already.
+     */
+    template<typename InType, typename OutType, typename KernelType>
+    void ApplyStencilRows(const InType* in, InType outside, OutType* out, int32 firstRow, int32 lastRow, KernelType kernel) const
+    {
+        int32 w=mapsizex;
+        for (int32 y=firstRow; y<lastRow; y++) {
+            int32 rowStart=y*w;
+            if ((y==0) || (y==mapsizey-1) || (w<3)) {
+                for (int32 i=rowStart; i<rowStart+w; i++) {
+                    ApplyStencilWithTable(in, outside, out, i, kernel);
+                }
+                continue;
+            }
+            ApplyStencilWithTable(in, outside, out, rowStart, kernel);
+            for (int32 i=rowStart+1; i<rowStart+w-1; i++) {
+                InType values[6]={in[i+1], in[i+w], in[i+w-1], in[i-1], in[i-w], in[i-w+1]};
+                out[i]=kernel(i, values);
+            }
+            ApplyStencilWithTable(in, outside, out, rowStart+w-1, kernel);
+        }
+    }
+
+    //Whole map stencil (see ApplyStencilRows), rows split between threads; the kernel can be called from any thread
+    template<typename InType, typename OutType, typename KernelType>
+    void ApplyStencil(const TArray<InType>& in, InType outside, TArray<OutType>& out, KernelType kernel) const
+    {
+        check(in.Num() == Num());
+        out.SetNumUninitialized(Num());
+        const InType* inData=in.GetData();
+        OutType* outData=out.GetData();
+        ParallelFor(mapsizey, [this, inData, outside, outData, &kernel](int32 y) {
+            ApplyStencilRows(inData, outside, outData, y, y+1, kernel);
+        });
+    }
+
+private:
+
+    template<typename InType, typename OutType, typename KernelType>
+    FORCEINLINE void ApplyStencilWithTable(const InType* in, InType outside, OutType* out, int32 i, KernelType& kernel) const
+    {
+        const int32* neighbors=getNeighbors(i);
+        InType values[6];
+        for (int32 j=0; j<6; j++) {
+            values[j]=(neighbors[j] != -1) ? in[neighbors[j]] : outside;
+        }
+        out[i]=kernel(i, values);
+    }
+
+    FORCEINLINE int32 WrapX(int32 x) const
+    {
+        return ((x % mapsizex) + mapsizex) % mapsizex;
+    }
+
+    //Union-find root lookup with path halving
+    static FORCEINLINE int32 FindRoot(TArray<int32>& parents, int32 i)
+    {
+        while (parents[i]!=i) {
+            parents[i]=parents[parents[i]];
+            i=parents[i];
+        }
+        return i;
+    }
+
+
+    //6 entries per tile, in slot order
+    TArray<int32> Neighbors;
+};
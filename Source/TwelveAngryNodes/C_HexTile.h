@@ -28,9 +28,6 @@ enum class EResource : uint8
     VE_Marble       UMETA(DisplayName="Marble"),
     VE_Salt         UMETA(DisplayName="Salt"),
     VE_Slate        UMETA(DisplayName="Slate"),
-    //Fishing boats
-    //Camps
-    //Pastures
     //Farms
     VE_Barley       UMETA(DisplayName="Barley"),
     VE_Beans        UMETA(DisplayName="Beans"),
@@ -38,7 +35,28 @@ enum class EResource : uint8
     VE_Rice         UMETA(DisplayName="Rice"),
     VE_Tomato       UMETA(DisplayName="Tomato"),
     VE_Wheat        UMETA(DisplayName="Wheat"),
+    //Families below were added after the farms, so that saved maps keep their values
     //Plantations
+    VE_Cotton       UMETA(DisplayName="Cotton"),
+    VE_Spices       UMETA(DisplayName="Spices"),
+    VE_Sugar        UMETA(DisplayName="Sugar"),
+    VE_Wine         UMETA(DisplayName="Wine"),
+    //Pastures
+    VE_Cattle       UMETA(DisplayName="Cattle"),
+    VE_Horses       UMETA(DisplayName="Horses"),
+    VE_Sheep        UMETA(DisplayName="Sheep"),
+    //Camps
+    VE_Deer         UMETA(DisplayName="Deer"),
+    VE_Furs         UMETA(DisplayName="Furs"),
+    VE_Ivory        UMETA(DisplayName="Ivory"),
+    //Lumbermills
+    VE_Hardwood     UMETA(DisplayName="Hardwood"),
+    VE_Pine         UMETA(DisplayName="Pine"),
+    //Fishing boats
+    VE_Fish         UMETA(DisplayName="Fish"),
+    VE_Crabs        UMETA(DisplayName="Crabs"),
+    VE_Pearls       UMETA(DisplayName="Pearls"),
+    VE_Whales       UMETA(DisplayName="Whales")
 };
 
 UENUM(BlueprintType)
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_HexTileStore.h"
+
+//Bit layout of the records, in EHexTileField order; the 32 bits are all used. Altitude and city owner are stored shifted by 1 so that -1 fits
+const FHexTileStore::FFieldLayout FHexTileStore::Layouts[(int32)EHexTileField::Count] = {
+    {0, 0x7, 1},    //Altitude
+    {3, 0xF, 0},    //Terrain
+    {7, 0x1, 0},    //Forest
+    {8, 0x3, 0},    //FreshWater
+    {10, 0x3F, 0},  //RiverEdges
+    {16, 0x3F, 0},  //Resource
+    {22, 0xF, 0},   //Improvement
+    {26, 0xF, 1},   //CityOwner
+    {30, 0x1, 0},   //PositiveTwin
+    {31, 0x1, 0}    //NegativeTwin
+};
+
+FHexTileStore::FHexTileStore() : mapsizex(0), mapsizey(0), RecordData(nullptr), NumRecords(0)
+{
+
+}
+
+FHexTileStore::FHexTileStore(int32 inMapsizex, int32 inMapsizey)
+{
+    Init(inMapsizex, inMapsizey);
+}
+
+FHexTileStore::FHexTileStore(const FHexTileStore& other)
+{
+    *this=other;
+}
+
+//Copies always own their records, so that writing to a copy never changes a shared buffer
+FHexTileStore& FHexTileStore::operator=(const FHexTileStore& other)
+{
+    if (this != &other) {
+        mapsizex=other.mapsizex;
+        mapsizey=other.mapsizey;
+        Records=TArray<uint32>(other.RecordData, other.NumRecords);
+        RecordData=Records.GetData();
+        NumRecords=Records.Num();
+        Buffer.Reset();
+    }
+    return *this;
+}
+
+void FHexTileStore::Init(int32 inMapsizex, int32 inMapsizey)
+{
+    mapsizex=inMapsizex;
+    mapsizey=inMapsizey;
+    //A zeroed record has no city but altitude -1, so the altitude bias is put back in
+    const FFieldLayout& altitude=Layouts[(int32)EHexTileField::Altitude];
+    Records.Init((uint32)altitude.Bias << altitude.Shift, mapsizex*mapsizey);
+    RecordData=Records.GetData();
+    NumRecords=Records.Num();
+    Buffer.Reset();
+}
+
+bool FHexTileStore::AttachToBuffer(int32 inMapsizex, int32 inMapsizey, const TSharedPtr<TArray<uint8>>& buffer, int64 offset)
+{
+    int64 size=(int64)inMapsizex*inMapsizey*sizeof(uint32);
+    if (!buffer.IsValid() || (offset<0) || (offset+size > buffer->Num()) || (((UPTRINT)(buffer->GetData()+offset)) % alignof(uint32) != 0)) {
+        return false;
+    }
+    mapsizex=inMapsizex;
+    mapsizey=inMapsizey;
+    Records.Empty();
+    Buffer=buffer;
+    RecordData=(uint32*)(Buffer->GetData()+offset);
+    NumRecords=inMapsizex*inMapsizey;
+    return true;
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "C_HexTile.h"
+
+//Fields of a packed tile record
+enum class EHexTileField : uint8
+{
+    Altitude,       //-1 to 6 (land loses 1 in ReduceLandAltitude)
+    Terrain,        //ETerrain
+    Forest,         //0 is no forest, 1 is forest
+    FreshWater,     //0 is no fresh water, 1 is next to lake, 2 is next to river
+    RiverEdges,     //bit dir-1 set when there is a river on the 'dir' side
+    Resource,       //EResource
+    Improvement,    //EImprovement
+    CityOwner,      //-1 is no city, other values are the owning faction
+    PositiveTwin,   //0 or 1
+    NegativeTwin,   //0 or 1
+    Count
+};
+
+/**
+ * Per tile map state packed in one 32 bit word per tile :
+ * bits 0-2 altitude (+1), 3-6 terrain, 7 forest, 8-9 fresh water, 10-15 river edges, 16-21 resource, 22-25 improvement, 26-29 city owner (+1), 30 positive twin, 31 negative twin.
+ * A 1024x641 map fits in 2.5 MB, and everything known about a tile is read with a single load.
+ * Shared (through a TSharedPtr) by the map generator and the game manager; each civ manager keeps its own copy of the tiles as last seen.
+ * The records can also be used in place from a loaded world file (see AttachToBuffer and C_WorldFile.h).
+ */
+class TWELVEANGRYNODES_API FHexTileStore
+{
+public:
+
+    //VARIABLES
+
+    int32 mapsizex;
+    int32 mapsizey;
+
+    //FUNCTIONS
+
+    FHexTileStore();
+    FHexTileStore(int32 inMapsizex, int32 inMapsizey);
+
+    //Resizes the store for the given map size; all tiles are reset to altitude 0 ocean with nothing on it
+    void Init(int32 inMapsizex, int32 inMapsizey);
+
+    //Points the store at records living in a shared buffer (such as a loaded world file) instead of copying them; returns false if they don't fit in the buffer
+    //Writes go to the buffer. Copying the store gives a store owning its records again
+    bool AttachToBuffer(int32 inMapsizex, int32 inMapsizey, const TSharedPtr<TArray<uint8>>& buffer, int64 offset);
+    
+    FHexTileStore(const FHexTileStore& other);
+    FHexTileStore& operator=(const FHexTileStore& other);
+    
+    FORCEINLINE int32 Num() const
+    {
+        return NumRecords;
+    }
+
+    //Generic field access; values are stored as is, except for the altitude and the city owner which are stored shifted by 1 so that -1 fits
+    FORCEINLINE int32 GetField(int32 index, EHexTileField field) const
+    {
+        const FFieldLayout& layout=Layouts[(int32)field];
+        checkSlow((index>=0) && (index<NumRecords));
+        return (int32)((RecordData[index] >> layout.Shift) & layout.Mask) - layout.Bias;
+    }
+
+    FORCEINLINE void SetField(int32 index, EHexTileField field, int32 value)
+    {
+        const FFieldLayout& layout=Layouts[(int32)field];
+        checkSlow((index>=0) && (index<NumRecords));
+        RecordData[index] = (RecordData[index] & ~(layout.Mask << layout.Shift)) | ((((uint32)(value + layout.Bias)) & layout.Mask) << layout.Shift);
+    }
+
+    //Typed accessors
+    FORCEINLINE int32 getAltitude(int32 index) const {return GetField(index, EHexTileField::Altitude);}
+    FORCEINLINE ETerrain getTerrain(int32 index) const {return (ETerrain)GetField(index, EHexTileField::Terrain);}
+    FORCEINLINE int32 getForest(int32 index) const {return GetField(index, EHexTileField::Forest);}
+    FORCEINLINE int32 getFreshWater(int32 index) const {return GetField(index, EHexTileField::FreshWater);}
+    FORCEINLINE uint8 getRiverEdges(int32 index) const {return (uint8)GetField(index, EHexTileField::RiverEdges);}
+    FORCEINLINE EResource getResource(int32 index) const {return (EResource)GetField(index, EHexTileField::Resource);}
+    FORCEINLINE EImprovement getImprovement(int32 index) const {return (EImprovement)GetField(index, EHexTileField::Improvement);}
+    FORCEINLINE int32 getCityOwner(int32 index) const {return GetField(index, EHexTileField::CityOwner);}
+    FORCEINLINE bool hasPositiveTwin(int32 index) const {return GetField(index, EHexTileField::PositiveTwin) != 0;}
+    FORCEINLINE bool hasNegativeTwin(int32 index) const {return GetField(index, EHexTileField::NegativeTwin) != 0;}
+
+    FORCEINLINE void setAltitude(int32 index, int32 value) {SetField(index, EHexTileField::Altitude, value);}
+    FORCEINLINE void setTerrain(int32 index, ETerrain value) {SetField(index, EHexTileField::Terrain, (int32)value);}
+    FORCEINLINE void setForest(int32 index, int32 value) {SetField(index, EHexTileField::Forest, value);}
+    FORCEINLINE void setFreshWater(int32 index, int32 value) {SetField(index, EHexTileField::FreshWater, value);}
+    FORCEINLINE void setRiverEdges(int32 index, uint8 value) {SetField(index, EHexTileField::RiverEdges, value);}
+    FORCEINLINE void setResource(int32 index, EResource value) {SetField(index, EHexTileField::Resource, (int32)value);}
+    FORCEINLINE void setImprovement(int32 index, EImprovement value) {SetField(index, EHexTileField::Improvement, (int32)value);}
+    FORCEINLINE void setCityOwner(int32 index, int32 value) {SetField(index, EHexTileField::CityOwner, value);}
+    FORCEINLINE void setPositiveTwin(int32 index, bool value) {SetField(index, EHexTileField::PositiveTwin, value ? 1 : 0);}
+    FORCEINLINE void setNegativeTwin(int32 index, bool value) {SetField(index, EHexTileField::NegativeTwin, value ? 1 : 0);}
+
+    //Returns true if there is a river between tile 'index' and its 'dir' neighbor; dir in [1,6]
+    FORCEINLINE bool IsRiverOn(int32 index, int32 dir) const
+    {
+        return (getRiverEdges(index) & (1 << (dir-1))) != 0;
+    }
+
+    //Bulk views : raw records, for serialization and whole map passes
+    FORCEINLINE const uint32* GetRecords() const {return RecordData;}
+    FORCEINLINE uint32* GetRecords() {return RecordData;}
+
+    //Bulk packing from and unpacking to one array per field, as used by the map generator and blueprints
+    template<typename ValueType>
+    void PackField(EHexTileField field, const TArray<ValueType>& values)
+    {
+        check(values.Num() == NumRecords);
+        for (int32 i=0; i<values.Num(); i++) {
+            SetField(i, field, (int32)values[i]);
+        }
+    }
+
+    template<typename ValueType>
+    TArray<ValueType> UnpackField(EHexTileField field) const
+    {
+        TArray<ValueType> values;
+        values.SetNumUninitialized(NumRecords);
+        for (int32 i=0; i<NumRecords; i++) {
+            values[i]=(ValueType)GetField(i, field);
+        }
+        return values;
+    }
+
+private:
+
+    struct FFieldLayout
+    {
+        uint32 Shift;
+        uint32 Mask;
+        int32 Bias;
+    };
+    static const FFieldLayout Layouts[(int32)EHexTileField::Count];
+
+    //Records owned by the store; empty when attached to a buffer
+    TArray<uint32> Records;
+    //Records in use : either Records or a part of Buffer
+    uint32* RecordData;
+    int32 NumRecords;
+    //Keeps the buffer the records point into alive
+    TSharedPtr<TArray<uint8>> Buffer;
+};
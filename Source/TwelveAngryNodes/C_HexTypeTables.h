@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+ Lookup tables used by AC_MapGenerator::GetHexTypesAndRotations.
+ Neighbor configurations are packed in 6 bit masks, bit j being the neighbor in direction j+1 (bit 0 = right ... bit 5 = botright).
+ Rotating a configuration by one step (60 degrees) moves bit j+1 to bit j; the ramp rotation is the number of steps needed to reach the canonical pattern of the ramp type.
+ */
+
+//Ramp mask -> ramp type (low 4 bits) and ramp rotation (high 4 bits)
+static constexpr uint8 HexRampTable[64] = {
+      0,   1,  17,   2,  33,   3,  18,   5,  49,   4,  19,   6,  34,  39,  21,   9,
+     65,  67,  20,   7,  35,   8,  22,  10,  50,  54,  55,  11,  37,  42,  25,  12,
+     81,  82,  83,  85,  36,  86,  23,  89,  51,  87,  24,  90,  38,  43,  26,  92,
+     66,  69,  70,  73,  71,  74,  27,  76,  53,  57,  58,  60,  41,  44,  28,  13,
+};
+
+//Ramp type, cliff mask (rotated to the canonical ramp pattern) -> coast type (low 4 bits), coast rotation on top of the ramp rotation (bits 4 to 6), and a last bit set when the rotation is random (symmetric patterns)
+static constexpr uint8 HexRandomRotationFlag = 128;
+static constexpr uint8 HexCoastTable[14][64] = {
+    {//000000
+        128,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//100000
+          1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110000
+          2,  17,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//101000
+          3,  33,   0,   0,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//100100
+          4,  49,   0,   0,   0,   0,   0,   0,   1,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111000
+          5,  18,   3,  33,   2,  17,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110100
+          6,  19,   4,  49,   0,   0,   0,   0,   2,  17,   1,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110010
+          7,  20,  67,  65,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          2,  17,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//101010
+          8,  35,   0,   0,  67,  65,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          3,  33,   0,   0,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111100
+          9,  21,  39,  34,   6,  19,   4,  49,   5,  18,   3,  33,   2,  17,   1,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111010
+         10,  22,   8,  35,   7,  20,  67,  65,   0,   0,   0,   0,   0,   0,   0,   0,
+          5,  18,   3,  33,   2,  17,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110110
+         11,  55,  54,  50,   0,   0,   0,   0,   7,  20,  67,  65,   0,   0,   0,   0,
+          6,  19,   4,  49,   0,   0,   0,   0,   2,  17,   1,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111110
+         12,  25,  42,  37,  11,  55,  54,  50,  10,  22,   8,  35,   7,  20,  67,  65,
+          9,  21,  39,  34,   6,  19,   4,  49,   5,  18,   3,  33,   2,  17,   1,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111111
+        141,  28,  44,  41,  60,  58,  57,  53,  76,  27,  74,  71,  73,  70,  69,  66,
+         92,  26,  43,  38,  90,  24,  87,  51,  89,  23,  86,  36,  85,  83,  82,  81,
+         12,  25,  42,  37,  11,  55,  54,  50,  10,  22,   8,  35,   7,  20,  67,  65,
+          9,  21,  39,  34,   6,  19,   4,  49,   5,  18,   3,  33,   2,  17,   1,   0,
+    },
+};
+
+//Ramp type, (rotated) cliff bits 0 to 2 and (rotated) ocean bits 2 to 4 -> ocean coast type; see HexOceanIndex
+static constexpr uint8 HexOceanCoastTable[14][64] = {
+    {//000000
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//100000
+          0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   0,   0,   0,   0,   0,   0,
+          2,   2,   0,   0,   0,   0,   0,   0,   4,   4,   0,   0,   0,   0,   0,   0,
+          3,   3,   0,   0,   0,   0,   0,   0,   5,   5,   0,   0,   0,   0,   0,   0,
+          6,   6,   0,   0,   0,   0,   0,   0,   7,   7,   0,   0,   0,   0,   0,   0,
+    },
+    {//110000
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          2,   1,   2,   2,   0,   0,   0,   0,   2,   1,   2,   2,   0,   0,   0,   0,
+          3,   2,   3,   3,   0,   0,   0,   0,   3,   2,   3,   3,   0,   0,   0,   0,
+          6,   4,   6,   6,   0,   0,   0,   0,   6,   4,   6,   6,   0,   0,   0,   0,
+    },
+    {//101000
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          3,   1,   0,   0,   3,   3,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          3,   1,   0,   0,   3,   3,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//100100
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111000
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          3,   2,   3,   1,   3,   2,   3,   3,   0,   0,   0,   0,   0,   0,   0,   0,
+          3,   2,   3,   1,   3,   2,   3,   3,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110100
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110010
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//101010
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111100
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111010
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//110110
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111110
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    {//111111
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    },
+};
+
+//Rotates a neighbor mask by "rotation" steps, the same way the ramp rotation rotates the neighbors
+static FORCEINLINE int32 RotateHexMask(int32 mask, int32 rotation)
+{
+    return ((mask >> rotation) | (mask << (6 - rotation))) & 63;
+}
+
+//Index in HexOceanCoastTable of rotated cliff and ocean masks; ocean coasts only depend on these 6 bits
+static FORCEINLINE int32 HexOceanIndex(int32 cliffMask, int32 oceanMask)
+{
+    return (cliffMask & 7) | (((oceanMask >> 2) & 7) << 3);
+}
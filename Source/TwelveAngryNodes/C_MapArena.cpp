@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapArena.h"
+
+//Enough for the lakes and river segments of a 128x81 map in a single block; bigger maps chain more blocks
+static const SIZE_T ArenaBlockSize = 64*1024;
+
+FMapGenerationArena::FMapGenerationArena() : Cursor(nullptr), End(nullptr), UsedBytes(0)
+{
+
+}
+
+FMapGenerationArena::FMapGenerationArena(const FMapGenerationArena& other) : Cursor(nullptr), End(nullptr), UsedBytes(0)
+{
+
+}
+
+FMapGenerationArena::~FMapGenerationArena()
+{
+    Reset();
+    for (int32 i=0; i<Blocks.Num(); i++) {
+        FMemory::Free(Blocks[i].Data);
+    }
+}
+
+//Blocks are as big as ArenaBlockSize, or as the allocation if it doesn't fit in one
+void FMapGenerationArena::AddBlock(SIZE_T minimumSize)
+{
+    SIZE_T size=FMath::Max(minimumSize, ArenaBlockSize);
+    FBlock block={(uint8*)FMemory::Malloc(size), size};
+    Blocks.Add(block);
+    Cursor=block.Data;
+    End=block.Data+size;
+}
+
+void* FMapGenerationArena::Allocate(SIZE_T size, SIZE_T alignment)
+{
+    uint8* start=(uint8*)(((UPTRINT)Cursor + alignment-1) & ~(UPTRINT)(alignment-1));
+    if ((Cursor == nullptr) || (start+size > End)) {
+        //Blocks come out of the allocator aligned for any type
+        AddBlock(size);
+        start=Cursor;
+    }
+    Cursor=start+size;
+    UsedBytes+=size;
+    return start;
+}
+
+void FMapGenerationArena::Reset()
+{
+    for (int32 i=Destructors.Num()-1; i>=0; i--) {
+        Destructors[i].Destroy(Destructors[i].Object);
+    }
+    Destructors.Empty();
+    for (int32 i=1; i<Blocks.Num(); i++) {
+        FMemory::Free(Blocks[i].Data);
+    }
+    if (Blocks.Num() > 0) {
+        Blocks.SetNum(1);
+        Cursor=Blocks[0].Data;
+        End=Blocks[0].Data+Blocks[0].Size;
+    }
+    UsedBytes=0;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Arena owning the objects a map generation keeps from the stage making them to the end of the generation (lakes, river segments).
+ * Objects are carved one after the other out of big blocks and are never freed one by one : Reset destroys all of them at once,
+ * which AC_MapGenerator does once the map has been handed over to the game manager, and before every new generation.
+ * Not thread safe : the stages making these objects (lakes, then rivers) never run at the same time.
+ * Temporaries only needed during a stage go on the FMemStack instead (TMemStackAllocator arrays), released by an FMemMark at the top of the stage function.
+ */
+class TWELVEANGRYNODES_API FMapGenerationArena
+{
+public:
+
+    FMapGenerationArena();
+    //Copies start empty : the objects belong to the generation of the original
+    FMapGenerationArena(const FMapGenerationArena& other);
+    ~FMapGenerationArena();
+
+    void* Allocate(SIZE_T size, SIZE_T alignment);
+
+    template<typename T, typename... ArgTypes>
+    T* New(ArgTypes&&... args)
+    {
+        T* object=new(Allocate(sizeof(T), alignof(T))) T(Forward<ArgTypes>(args)...);
+        if (!TIsTriviallyDestructible<T>::Value) {
+            FDestructor destructor={&DestroyObject<T>, object};
+            Destructors.Add(destructor);
+        }
+        return object;
+    }
+
+    //Destroys every object, the last made first, and frees every block but the first one, kept for the next generation
+    void Reset();
+
+    //Bytes handed out since the last reset
+    FORCEINLINE SIZE_T GetUsedBytes() const
+    {
+        return UsedBytes;
+    }
+
+private:
+
+    template<typename T>
+    static void DestroyObject(void* object)
+    {
+        ((T*)object)->~T();
+    }
+
+    struct FDestructor
+    {
+        void (*Destroy)(void*);
+        void* Object;
+    };
+
+    struct FBlock
+    {
+        uint8* Data;
+        SIZE_T Size;
+    };
+
+    void AddBlock(SIZE_T minimumSize);
+
+    TArray<FBlock> Blocks;
+    //Free part of the last block
+    uint8* Cursor;
+    uint8* End;
+    SIZE_T UsedBytes;
+    TArray<FDestructor> Destructors;
+
+    FMapGenerationArena& operator=(const FMapGenerationArena&);
+};
@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_HexGrid.h"
+#include "C_MapGenerator.h"
+#include "C_MapRandom.h"
+
+/*
+ Headless micro-benchmarks for the map code. The only actors they spawn are transient generators and managers (no hexes), destroyed once done, so they can be run from a commandlet-like session :
+ UE4Editor-Cmd TwelveAngryNodes.uproject -game -nullrhi -ExecCmds="tan.BenchmarkNeighbors,quit"
+ */
+
+//Old style lookup : rederives x and y from the index, then walks the switch (with the recursion for out of range directions)
+static int32 SwitchNeighbor(int32 index, int32 dir, int32 mapsizex, int32 mapsizey)
+{
+    if (dir>6) {
+        return SwitchNeighbor(index, dir-6, mapsizex, mapsizey);
+    }
+    else if (dir<1) {
+        return SwitchNeighbor(index, dir+6, mapsizex, mapsizey);
+    }
+    return FHexNeighborTable::ComputeNeighbor(index % mapsizex, index / mapsizex, dir, mapsizex, mapsizey);
+}
+
+static void BenchmarkNeighborsOnMap(int32 mapsizex, int32 mapsizey, int32 repeats)
+{
+    int32 mapsize=mapsizex*mapsizey;
+
+    double start=FPlatformTime::Seconds();
+    FHexNeighborTable table(mapsizex, mapsizey);
+    double buildTime=FPlatformTime::Seconds()-start;
+
+    //Both loops sum the neighbors so that the compiler can't throw the lookups away
+    int64 switchSum=0;
+    start=FPlatformTime::Seconds();
+    for (int32 r=0; r<repeats; r++) {
+        for (int32 i=0; i<mapsize; i++) {
+            for (int32 j=1; j<7; j++) {
+                switchSum+=SwitchNeighbor(i, j, mapsizex, mapsizey);
+            }
+        }
+    }
+    double switchTime=FPlatformTime::Seconds()-start;
+
+    int64 tableSum=0;
+    start=FPlatformTime::Seconds();
+    for (int32 r=0; r<repeats; r++) {
+        for (int32 i=0; i<mapsize; i++) {
+            for (int32 j=1; j<7; j++) {
+                tableSum+=table.getNeighbor(i, j);
+            }
+        }
+    }
+    double tableTime=FPlatformTime::Seconds()-start;
+
+    double lookups=(double)mapsize*6.*repeats;
+    UE_LOG(LogMapGeneration, Display, TEXT("Neighbors %dx%d : table build %.3f ms, switch %.2f ns/lookup, table %.2f ns/lookup (%s)"),
+           mapsizex, mapsizey, buildTime*1000., switchTime*1e9/lookups, tableTime*1e9/lookups,
+           (switchSum==tableSum) ? TEXT("results match") : TEXT("RESULTS DIFFER"));
+}
+
+static void BenchmarkNeighbors()
+{
+    BenchmarkNeighborsOnMap(128, 81, 200);
+    BenchmarkNeighborsOnMap(1024, 641, 5);
+}
+
+static FAutoConsoleCommand BenchmarkNeighborsCommand(
+    TEXT("tan.BenchmarkNeighbors"),
+    TEXT("Compares the precomputed hex neighbor table to the old switch based lookup on 128x81 and 1024x641 maps"),
+    FConsoleCommandDelegate::CreateStatic(&BenchmarkNeighbors));
+
+
+//Old style ocean check : walks the neighbors of the tile through getNeighbor
+static bool OceanWithLookups(const FHexNeighborTable& table, const TArray<int32>& altitudes, int32 i)
+{
+    if (altitudes[i] != 0) {
+        return false;
+    }
+    for (int32 j=1; j<7; j++) {
+        int32 neighbor=table.getNeighbor(i, j);
+        if ((neighbor != -1) && (altitudes[neighbor] != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Old style long land chain check, as PostProcessLongLandChains used to do it
+static bool LongChainWithLookups(const FHexNeighborTable& table, const TArray<int32>& altitudes, int32 i)
+{
+    if (altitudes[i] != 1) {
+        return false;
+    }
+    int32 water=0;
+    for (int32 j=1; j<7; j++) {
+        int32 neighbor=table.getNeighbor(i, j);
+        if (neighbor != -1) {
+            if (altitudes[neighbor] == 0) {
+                water++;
+            }
+            else if (altitudes[neighbor] != 1) {
+                return false;
+            }
+        }
+    }
+    return water == 4;
+}
+
+//Per tile loops through getNeighbor against the row stencil, on the same random altitude map; both single threaded, to compare the loops themselves
+static void BenchmarkStencils()
+{
+    int32 mapsizex=1024;
+    int32 mapsizey=641;
+    int32 mapsize=mapsizex*mapsizey;
+    int32 repeats=20;
+    FHexNeighborTable table(mapsizex, mapsizey);
+    TArray<int32> altitudes;
+    altitudes.SetNum(mapsize);
+    for (int32 i=0; i<mapsize; i++) {
+        //Mostly water, so that the ocean checks don't all stop at the first neighbor
+        altitudes[i]=FMath::Max(FMapRandom::RandRange(1, EMapRandomStage::AltitudeChains, i, 0, -6, 3), 0);
+    }
+    
+    TArray<uint8> lookupOcean;
+    TArray<uint8> lookupChains;
+    lookupOcean.SetNum(mapsize);
+    lookupChains.SetNum(mapsize);
+    double start=FPlatformTime::Seconds();
+    for (int32 r=0; r<repeats; r++) {
+        for (int32 i=0; i<mapsize; i++) {
+            lookupOcean[i]=OceanWithLookups(table, altitudes, i);
+            lookupChains[i]=LongChainWithLookups(table, altitudes, i);
+        }
+    }
+    double lookupTime=FPlatformTime::Seconds()-start;
+    
+    TArray<uint8> stencilOcean;
+    TArray<uint8> stencilChains;
+    stencilOcean.SetNum(mapsize);
+    stencilChains.SetNum(mapsize);
+    const int32* altitudeData=altitudes.GetData();
+    start=FPlatformTime::Seconds();
+    for (int32 r=0; r<repeats; r++) {
+        table.ApplyStencilRows(altitudeData, 0, stencilOcean.GetData(), 0, mapsizey, [altitudeData](int32 i, const int32* neighbors) {
+            int32 land=0;
+            for (int32 j=0; j<6; j++) {
+                land+=(neighbors[j] != 0);
+            }
+            return (uint8)((altitudeData[i] == 0) & (land == 0));
+        });
+        table.ApplyStencilRows(altitudeData, 1, stencilChains.GetData(), 0, mapsizey, [altitudeData](int32 i, const int32* neighbors) {
+            int32 water=0;
+            int32 higher=0;
+            for (int32 j=0; j<6; j++) {
+                water+=(neighbors[j] == 0);
+                higher+=(neighbors[j] > 1);
+            }
+            return (uint8)((altitudeData[i] == 1) & (water == 4) & (higher == 0));
+        });
+    }
+    double stencilTime=FPlatformTime::Seconds()-start;
+    
+    bool match=(FMemory::Memcmp(lookupOcean.GetData(), stencilOcean.GetData(), mapsize)==0) && (FMemory::Memcmp(lookupChains.GetData(), stencilChains.GetData(), mapsize)==0);
+    double tiles=(double)mapsize*repeats;
+    UE_LOG(LogMapGeneration, Display, TEXT("Stencils %dx%d (ocean and long chain checks) : per tile lookups %.2f ns/tile, row stencil %.2f ns/tile (%s)"),
+           mapsizex, mapsizey, lookupTime*1e9/tiles, stencilTime*1e9/tiles, match ? TEXT("results match") : TEXT("RESULTS DIFFER"));
+}
+
+static FAutoConsoleCommand BenchmarkStencilsCommand(
+    TEXT("tan.BenchmarkStencils"),
+    TEXT("Compares the per tile neighbor loops of the map passes to the row stencil on a 1024x641 map"),
+    FConsoleCommandDelegate::CreateStatic(&BenchmarkStencils));
+
+//Game managers are actors too, spawned as the generators (see AC_MapGenerator::SpawnTransientGenerator)
+static AC_GameManager* SpawnTransientManager(UWorld* world)
+{
+    FActorSpawnParameters parameters;
+    parameters.ObjectFlags|=RF_Transient;
+    parameters.SpawnCollisionHandlingOverride=ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    return world->SpawnActor<AC_GameManager>(parameters);
+}
+
+//Time to playable for a 1024x641 map : full generation against loading the same map from a world file, both up to an initialized game manager
+static void BenchmarkWorldLoad(UWorld* world)
+{
+    if (world == nullptr) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("tan.BenchmarkWorldLoad needs a world to spawn its generators in"));
+        return;
+    }
+    FString path=FPaths::GameSavedDir() + TEXT("Benchmarks/BenchmarkWorld.world");
+    
+    AC_GameManager* generatedManager=SpawnTransientManager(world);
+    AC_MapGenerator* generator=AC_MapGenerator::SpawnTransientGenerator(world, nullptr);
+    generator->mapsizex=1024;
+    generator->mapsizey=641;
+    generator->Seed=1;
+    generator->bUseMapCache=false;
+    generator->manager=generatedManager;
+    
+    //The map has to be saved before the hand-off to the game manager, which releases the generation data
+    double start=FPlatformTime::Seconds();
+    generator->GenerateMap(200);
+    double generateTime=FPlatformTime::Seconds()-start;
+    
+    start=FPlatformTime::Seconds();
+    bool saved=generator->SaveWorld(path);
+    double saveTime=FPlatformTime::Seconds()-start;
+    
+    start=FPlatformTime::Seconds();
+    generator->InitializeGameManager();
+    generateTime+=FPlatformTime::Seconds()-start;
+    
+    AC_GameManager* loadedManager=SpawnTransientManager(world);
+    AC_MapGenerator* loader=AC_MapGenerator::SpawnTransientGenerator(world, nullptr);
+    loader->manager=loadedManager;
+    
+    start=FPlatformTime::Seconds();
+    bool loaded=saved && loader->LoadWorld(path);
+    if (loaded) {
+        loader->InitializeGameManager();
+    }
+    double loadTime=FPlatformTime::Seconds()-start;
+    
+    bool match=loaded && (loadedManager->TileStore->Num()==generatedManager->TileStore->Num())
+    && (FMemory::Memcmp(loadedManager->TileStore->GetRecords(), generatedManager->TileStore->GetRecords(), generatedManager->TileStore->Num()*sizeof(uint32))==0);
+    UE_LOG(LogMapGeneration, Display, TEXT("World 1024x641 : generation %.1f ms, save %.1f ms, load %.1f ms (%s)"),
+           generateTime*1000., saveTime*1000., loadTime*1000.,
+           !loaded ? TEXT("LOAD FAILED") : (match ? TEXT("tiles match") : TEXT("TILES DIFFER")));
+    
+    generator->Destroy();
+    loader->Destroy();
+    generatedManager->Destroy();
+    loadedManager->Destroy();
+}
+
+static FAutoConsoleCommandWithWorld BenchmarkWorldLoadCommand(
+    TEXT("tan.BenchmarkWorldLoad"),
+    TEXT("Compares generating a 1024x641 map to loading it from a world file, up to an initialized game manager"),
+    FConsoleCommandWithWorldDelegate::CreateStatic(&BenchmarkWorldLoad));
+
+
+//Generation of a 2048x1281 map, stage by stage, with both altitude modes; the altitude is meant to stay well under a second at that size
+static void BenchmarkGenerationMode(UWorld* world, EAltitudeMode mode, const TCHAR* modeName)
+{
+    AC_MapGenerator* generator=AC_MapGenerator::SpawnTransientGenerator(world, nullptr);
+    generator->mapsizex=2048;
+    generator->mapsizey=1281;
+    generator->Seed=1;
+    generator->bUseMapCache=false;
+    generator->AltitudeMode=mode;
+    
+    double start=FPlatformTime::Seconds();
+    generator->GenerateMap(800);
+    double generateTime=FPlatformTime::Seconds()-start;
+    
+    UE_LOG(LogMapGeneration, Display, TEXT("Generation 2048x1281 (%s altitude) : %.1f ms (%s)"), modeName, generateTime*1000., *generator->GetGenerationTimingsReport());
+    generator->Destroy();
+}
+
+static void BenchmarkGeneration(UWorld* world)
+{
+    if (world == nullptr) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("tan.BenchmarkGeneration needs a world to spawn its generators in"));
+        return;
+    }
+    BenchmarkGenerationMode(world, EAltitudeMode::VE_Chains, TEXT("chain"));
+    BenchmarkGenerationMode(world, EAltitudeMode::VE_Noise, TEXT("noise"));
+}
+
+static FAutoConsoleCommandWithWorld BenchmarkGenerationCommand(
+    TEXT("tan.BenchmarkGeneration"),
+    TEXT("Generates a 2048x1281 map with each altitude mode and logs the time of every generation stage"),
+    FConsoleCommandWithWorldDelegate::CreateStatic(&BenchmarkGeneration));
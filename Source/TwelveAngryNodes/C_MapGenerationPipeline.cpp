@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapGenerationPipeline.h"
+
+FMapGenerationPipeline::FMapGenerationPipeline() : bRunning(false), bCancelRequested(false), CompletedStages(0), CurrentStage(-1), FirstStage(0), StartSeconds(0.), TotalSeconds(0.)
+{
+
+}
+
+void FMapGenerationPipeline::AddStage(const FString& name, EMapChannel reads, EMapChannel writes, TFunction<void()> run, uint32 parametersHash)
+{
+    FMapGenerationStage stage;
+    stage.Name=name;
+    stage.Index=Stages.Num();
+    stage.ParametersHash=parametersHash;
+    stage.Reads=reads;
+    stage.Writes=writes;
+    stage.Run=run;
+    stage.Seconds=0.;
+
+    //Read after write, write after read and write after write all have to keep their order
+    EMapChannel used=reads | writes;
+    for (int32 i=0; i<Stages.Num(); i++) {
+        if (EnumHasAnyFlags(Stages[i].Writes, used) || EnumHasAnyFlags(Stages[i].Reads, writes)) {
+            stage.Prerequisites.Add(i);
+        }
+    }
+    Stages.Add(stage);
+}
+
+void FMapGenerationPipeline::BeginRun()
+{
+    check(!bRunning);
+    bRunning=true;
+    CompletedStages.Reset();
+    CurrentStage.Set(-1);
+    StartSeconds=FPlatformTime::Seconds();
+}
+
+bool FMapGenerationPipeline::EndRun()
+{
+    TotalSeconds=FPlatformTime::Seconds()-StartSeconds;
+    bRunning=false;
+    return !bCancelRequested;
+}
+
+void FMapGenerationPipeline::RunStage(int32 index)
+{
+    if (bCancelRequested) {
+        return;
+    }
+    //Skipped stages count as done, so that the progress still goes from 0 to 1
+    if (index < FirstStage) {
+        CompletedStages.Increment();
+        return;
+    }
+    CurrentStage.Set(index);
+    double start=FPlatformTime::Seconds();
+    Stages[index].Run();
+    Stages[index].Seconds=FPlatformTime::Seconds()-start;
+    if (StageDoneCallback) {
+        StageDoneCallback(Stages[index]);
+    }
+    CompletedStages.Increment();
+}
+
+bool FMapGenerationPipeline::Run()
+{
+    BeginRun();
+    for (int32 i=0; i<Stages.Num(); i++) {
+        RunStage(i);
+    }
+    return EndRun();
+}
+
+bool FMapGenerationPipeline::RunOnTaskGraph()
+{
+    BeginRun();
+    FGraphEventArray stageEvents;
+    for (int32 i=0; i<Stages.Num(); i++) {
+        FGraphEventArray prerequisites;
+        for (int32 j=0; j<Stages[i].Prerequisites.Num(); j++) {
+            prerequisites.Add(stageEvents[Stages[i].Prerequisites[j]]);
+        }
+        stageEvents.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([this, i]() {
+            RunStage(i);
+        }, TStatId(), &prerequisites));
+    }
+    FTaskGraphInterface::Get().WaitUntilTasksComplete(stageEvents);
+    return EndRun();
+}
+
+FString FMapGenerationPipeline::GetCurrentStageName() const
+{
+    int32 index=CurrentStage.GetValue();
+    return (index >= 0) ? Stages[index].Name : FString();
+}
+
+FString FMapGenerationPipeline::GetTimingsReport() const
+{
+    FString report;
+    for (int32 i=0; i<Stages.Num(); i++) {
+        if (i < FirstStage) {
+            report+=FString::Printf(TEXT("%s skipped, "), *Stages[i].Name);
+        }
+        else {
+            report+=FString::Printf(TEXT("%s %.1f ms, "), *Stages[i].Name, Stages[i].Seconds*1000.);
+        }
+    }
+    report+=FString::Printf(TEXT("total %.1f ms"), TotalSeconds*1000.);
+    return report;
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Async/TaskGraphInterfaces.h"
+
+//Data read or written by a map generation stage
+enum class EMapChannel : uint32
+{
+    None            = 0,
+    Altitude        = 1 << 0,
+    Terrain         = 1 << 1,
+    Lakes           = 1 << 2,   //Lakes, water bodies and the lake index
+    TileLists       = 1 << 3,   //LandTiles and WaterTiles
+    Rivers          = 1 << 4,   //River segments, bank counts and river edges
+    FreshWater      = 1 << 5,
+    HexTypes        = 1 << 6,   //Ramp and coast types and rotations
+    Forests         = 1 << 7,
+    Resources       = 1 << 8,   //Resources and their rotations
+    Improvements    = 1 << 9,
+    StartingSpots   = 1 << 10,
+    Distances       = 1 << 11,  //Distance fields
+    Regions         = 1 << 12   //Start regions
+};
+ENUM_CLASS_FLAGS(EMapChannel)
+
+struct FMapGenerationStage
+{
+    FString Name;
+    //Place of the stage in the pipeline
+    int32 Index;
+    EMapChannel Reads;
+    EMapChannel Writes;
+    TFunction<void()> Run;
+    //Checksum of the parameters the stage depends on, apart from the data it reads (0 if there are none); see SetFirstStage
+    uint32 ParametersHash;
+    //Earlier stages this one has to wait for
+    TArray<int32> Prerequisites;
+    //Wall time of the last run, in seconds
+    double Seconds;
+};
+
+/**
+ * Map generation stages along with the data they read and write.
+ * A stage waits for every earlier stage it conflicts with (one of them writes a channel the other one uses), so running the stages
+ * on the task graph gives the same map as running them one after the other in declaration order, while independent stages overlap.
+ */
+class TWELVEANGRYNODES_API FMapGenerationPipeline
+{
+public:
+
+    FMapGenerationPipeline();
+
+    //Stages have to be added in the order they would run one after the other
+    void AddStage(const FString& name, EMapChannel reads, EMapChannel writes, TFunction<void()> run, uint32 parametersHash=0);
+
+    //Skips the stages before 'index', for incremental generation : their output has to be in place already (see AC_MapGenerator::bIncrementalGeneration)
+    //Has to be set before the run
+    FORCEINLINE void SetFirstStage(int32 index)
+    {
+        FirstStage=index;
+    }
+
+    FORCEINLINE int32 GetFirstStage() const
+    {
+        return FirstStage;
+    }
+
+    //Runs all stages one after the other on the calling thread; returns false if the run got cancelled
+    bool Run();
+
+    //Runs all stages on the task graph, overlapping the independent ones, and waits for them; returns false if the run got cancelled
+    //Meant for a worker thread (see FMapGenerationWorker)
+    bool RunOnTaskGraph();
+
+    //Cooperative cancellation : stages that haven't started yet are skipped, running ones finish; can be called from any thread, even before the run starts
+    //Pipelines are built for a single generation, so a cancelled pipeline stays cancelled
+    FORCEINLINE void RequestCancel()
+    {
+        bCancelRequested=true;
+    }
+
+    //Called right after every stage, on the thread which ran it and before the stages waiting for it start : lets the caller check the stage output,
+    //and cancel the rest of the run if it isn't worth going on; has to be set before the run
+    FORCEINLINE void SetStageDoneCallback(TFunction<void(const FMapGenerationStage&)> callback)
+    {
+        StageDoneCallback=callback;
+    }
+
+    FORCEINLINE bool IsCancelRequested() const
+    {
+        return bCancelRequested;
+    }
+
+    FORCEINLINE bool IsRunning() const
+    {
+        return bRunning;
+    }
+
+    //Share of the stages done, from 0 to 1; can be polled from any thread
+    FORCEINLINE float GetProgress() const
+    {
+        return (Stages.Num() > 0) ? (float)CompletedStages.GetValue()/Stages.Num() : 1.f;
+    }
+
+    //Name of the last stage which started; can be polled from any thread
+    FString GetCurrentStageName() const;
+
+    FORCEINLINE const TArray<FMapGenerationStage>& GetStages() const
+    {
+        return Stages;
+    }
+
+    //Wall time of the whole last run, in seconds; less than the sum of the stage times when stages overlapped
+    FORCEINLINE double GetTotalSeconds() const
+    {
+        return TotalSeconds;
+    }
+
+    //One line with the time of every stage and the total, for the log
+    FString GetTimingsReport() const;
+
+private:
+
+    void BeginRun();
+    bool EndRun();
+    void RunStage(int32 index);
+
+    //Not changed while running, so that threads can read it
+    TArray<FMapGenerationStage> Stages;
+    TFunction<void(const FMapGenerationStage&)> StageDoneCallback;
+    int32 FirstStage;
+    FThreadSafeBool bRunning;
+    FThreadSafeBool bCancelRequested;
+    FThreadSafeCounter CompletedStages;
+    //Index of the last started stage, -1 before the first one
+    FThreadSafeCounter CurrentStage;
+    double StartSeconds;
+    double TotalSeconds;
+};
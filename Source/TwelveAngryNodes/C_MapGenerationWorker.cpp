@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapGenerationWorker.h"
+
+FMapGenerationWorker::FMapGenerationWorker(const TSharedPtr<FMapGenerationPipeline>& inPipeline, TFunction<void(bool)> inOnComplete)
+: Pipeline(inPipeline), OnComplete(inOnComplete), Thread(nullptr)
+{
+
+}
+
+FMapGenerationWorker::~FMapGenerationWorker()
+{
+    if (Thread != nullptr) {
+        Pipeline->RequestCancel();
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread=nullptr;
+    }
+}
+
+bool FMapGenerationWorker::Start()
+{
+    check(Thread == nullptr);
+    Thread=FRunnableThread::Create(this, TEXT("MapGenerationWorker"));
+    return Thread != nullptr;
+}
+
+void FMapGenerationWorker::WaitForCompletion()
+{
+    if (Thread != nullptr) {
+        Thread->WaitForCompletion();
+    }
+}
+
+uint32 FMapGenerationWorker::Run()
+{
+    bool completed=Pipeline->RunOnTaskGraph();
+
+    //Only the callback goes back to the game thread; the worker object may be gone by the time it runs, so it only carries copies
+    TFunction<void(bool)> onComplete=OnComplete;
+    FFunctionGraphTask::CreateAndDispatchWhenReady([onComplete, completed]() {
+        onComplete(completed);
+    }, TStatId(), nullptr, ENamedThreads::GameThread);
+    return 0;
+}
+
+void FMapGenerationWorker::Stop()
+{
+    Pipeline->RequestCancel();
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "C_MapGenerationPipeline.h"
+
+/**
+ * Runs a map generation pipeline on a thread of its own, so that the game thread never waits for the generation.
+ * The stages still overlap on the task graph; once they are done, the completion callback is sent back to the game thread,
+ * where the hexes can be spawned. Progress and cancellation go through the pipeline.
+ */
+class TWELVEANGRYNODES_API FMapGenerationWorker : public FRunnable
+{
+public:
+
+    //onComplete is called on the game thread, with true if all stages ran and false if the pipeline got cancelled
+    FMapGenerationWorker(const TSharedPtr<FMapGenerationPipeline>& inPipeline, TFunction<void(bool)> inOnComplete);
+    virtual ~FMapGenerationWorker();
+
+    //Creates the thread, which starts running right away
+    bool Start();
+
+    //Blocks until the thread is done; cancel the pipeline first to only wait for the running stages
+    void WaitForCompletion();
+
+    //FRunnable interface
+    virtual uint32 Run() override;
+    virtual void Stop() override;
+
+private:
+
+    TSharedPtr<FMapGenerationPipeline> Pipeline;
+    TFunction<void(bool)> OnComplete;
+    FRunnableThread* Thread;
+};
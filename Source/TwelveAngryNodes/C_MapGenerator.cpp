@@ -3,12 +3,53 @@
 #include "TwelveAngryNodes.h"
 #include "UnrealMathUtility.h"
 #include <time.h>
+#include "Async/ParallelFor.h"
 #include "C_MapGenerator.h"
+#include "C_HexTypeTables.h"
+#include "C_ResourceTables.h"
+#include "C_WorldFile.h"
+#include "C_MapNoise.h"
+#include "C_MapSampler.h"
+#include "C_MapArena.h"
+
+//Part of the cache key of generated maps; bump it whenever the generation changes, so that old cached maps get generated again
+static const int32 MapCacheVersion = 8;
 
 //Empty constructor to be overriden in blueprint if necessary
 AC_MapGenerator::AC_MapGenerator(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
-    randomstream = FRandomStream(time(NULL));
+    Seed=0;
+    UsedSeed=0;
+    bUseMapCache=true;
+    bIncrementalGeneration=false;
+    MaxLakeSize=8;
+    MaxFilledLakeSize=8;
+    AltitudeMode=EAltitudeMode::VE_Chains;
+    //Same chains as the former fixed counts on a 64x41 map
+    LongChainsPerThousandTiles=0.f;
+    LongChainLength=1000;
+    MediumChainsPerThousandTiles=0.381f;
+    MediumChainLength=400;
+    ShortChainsPerThousandTiles=0.762f;
+    ShortChainLength=100;
+    TinyChainsPerThousandTiles=3.81f;
+    TinyChainLength=4;
+    NoiseFeatureSize=24.f;
+    NoiseOctaves=5;
+    LandShare=0.3f;
+    MidlandShare=0.12f;
+    HighlandShare=0.04f;
+    RiverMode=ERiverMode::VE_Walks;
+    RiverDrainageTiles=6;
+    ClimateMode=EClimateMode::VE_Moisture;
+    DesertMoisture=0.25f;
+    ForestMode=EForestMode::VE_CoinFlip;
+    ForestDensity=1.f;
+    NumberOfCivs=10;
+    StrategicResourcesPerRegion=2;
+    LuxuryResourcesPerRegion=2;
+    StartSpotRadius=2;
+    StartSpotCandidateShare=0.25f;
 }
 
 /*
@@ -39,210 +80,387 @@ int32 AC_MapGenerator::getY(int32 i){
     return (i / mapsizex);
 }
 
+//Returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright; returns -1 if out of map
+//Looks up the shared neighbor table, which assumes a cylinder wrap; dir can be out of [1,6] and gets wrapped around
 int32 AC_MapGenerator::getNeighbor(int32 index, int32 dir)
 {
-    return getNeighbor(getX(index), getY(index), dir);
+    return NeighborTable->getNeighbor(index, dir);
+}
+
+//Builds the neighbor table shared by the generator, the game manager and the civ managers; rebuilt only if the map size changed
+void AC_MapGenerator::BuildNeighborTable()
+{
+    if (!NeighborTable.IsValid() || (NeighborTable->mapsizex!=mapsizex) || (NeighborTable->mapsizey!=mapsizey)) {
+        NeighborTable=MakeShareable(new FHexNeighborTable(mapsizex, mapsizey));
+    }
 }
 
 
-//From a position on the hex grid x and y, returns the index of the 'dir' neighbor (in 1D arrays) : 1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright
-//Assumes a cylinder wrap, and so uses the xy notation for simplicity of finding special cases
-//Returns -1 if out of map
-//If dir is bigger than 6, subtracts 6 from dir and calls itself with new dir; if smaller than 1, adds 6 to dir and calls itself with new dir
-int32 AC_MapGenerator::getNeighbor(int32 x, int32 y, int32 dir)
+//Picks the seed of the generation : Seed, or the clock if Seed is 0; everything generated from there on only depends on UsedSeed and the map parameters
+void AC_MapGenerator::InitializeSeed()
 {
-    int32 ArrayPos=x+y*mapsizex;
-    switch (dir) {
-        case 1://going right
-            if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            else{
-                ArrayPos++;
-            }
-            break;
-        case 2://going topright
-            if (y==(mapsizey-1)) {
-                ArrayPos=-1; //going out top
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex;
-            }
-            break;
-        case 3://going topleft
-            if (y==(mapsizey-1)){
-                ArrayPos=-1; //going out top
-            }
-            else if (x==0) {
-                ArrayPos=ArrayPos+2*mapsizex-1;
-            }
-            else{
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            break;
-        case 4://going left
-            if (x==0) {
-                ArrayPos=ArrayPos+mapsizex-1;
-            }
-            else{
-                ArrayPos--;
-            }
-            break;
-        case 5://going botleft
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else{
-                ArrayPos=ArrayPos-mapsizex;
-            }
-            break;
-        case 6://going botright
-            if (y==0) {
-                ArrayPos=-1; //going out bot
-            }
-            else if (x==(mapsizex-1)) {
-                ArrayPos=ArrayPos-2*mapsizex+1;
-            }
-            else {
-                ArrayPos=ArrayPos-mapsizex+1;
-            }
-            break;
-        default:
-            if (dir>6) {
-                return getNeighbor(x, y, dir-6);
-            }
-            else if (dir<1) {
-                return getNeighbor(x, y, dir+6);
-            }
-            else {
-                ArrayPos=-1;
-            }
-            break;
+    UsedSeed = (Seed != 0) ? Seed : (int32)time(NULL);
+}
+
+//Runs the whole generation, from the altitude map to the starting spots; the hexes still have to be spawned before InitializeGameManager is called
+//With an explicit Seed and bUseMapCache, a map generated before with the same parameters is loaded from disk instead
+bool AC_MapGenerator::GenerateMap(int32 numberOfRivers)
+{
+    if (IsGeneratingMap()) {
+        return false;
+    }
+    if (bUseMapCache && (Seed != 0) && LoadMapCache(numberOfRivers)) {
+        return true;
+    }
+    GenerationPipeline=BuildGenerationPipeline(numberOfRivers);
+    PrepareIncrementalGeneration(*GenerationPipeline);
+    GenerationPipeline->Run();
+    FinishGeneration(numberOfRivers);
+    return false;
+}
+
+bool AC_MapGenerator::GenerateMapAsync(int32 numberOfRivers)
+{
+    if (IsGeneratingMap()) {
+        return false;
+    }
+    if (bUseMapCache && (Seed != 0) && LoadMapCache(numberOfRivers)) {
+        OnMapGenerated.Broadcast(true);
+        return true;
+    }
+    GenerationPipeline=BuildGenerationPipeline(numberOfRivers);
+    PrepareIncrementalGeneration(*GenerationPipeline);
+    TWeakObjectPtr<AC_MapGenerator> weakThis(this);
+    GenerationWorker=MakeShareable(new FMapGenerationWorker(GenerationPipeline, [weakThis, numberOfRivers](bool completed) {
+        if (weakThis.IsValid()) {
+            weakThis->OnGenerationWorkerDone(numberOfRivers, completed);
+        }
+    }));
+    if (!GenerationWorker->Start()) {
+        //No threading available : generate right away
+        GenerationWorker.Reset();
+        GenerationPipeline->Run();
+        FinishGeneration(numberOfRivers);
+        OnMapGenerated.Broadcast(false);
+    }
+    return true;
+}
+
+//Game thread side of the end of GenerateMapAsync
+void AC_MapGenerator::OnGenerationWorkerDone(int32 numberOfRivers, bool completed)
+{
+    GenerationWorker->WaitForCompletion();
+    GenerationWorker.Reset();
+    if (completed) {
+        FinishGeneration(numberOfRivers);
+        OnMapGenerated.Broadcast(false);
+    }
+    else {
+        UE_LOG(LogMapGeneration, Log, TEXT("Map generation cancelled during %s"), *GenerationPipeline->GetCurrentStageName());
+        ReleaseGenerationData();
+        OnMapGenerationCancelled.Broadcast();
+    }
+}
+
+void AC_MapGenerator::CancelMapGeneration()
+{
+    if (GenerationPipeline.IsValid()) {
+        GenerationPipeline->RequestCancel();
+    }
+}
+
+bool AC_MapGenerator::IsGeneratingMap()
+{
+    return GenerationWorker.IsValid() || (GenerationPipeline.IsValid() && GenerationPipeline->IsRunning());
+}
+
+//The stage functions are BlueprintCallable : a blueprint calling one while a GenerateMapAsync worker runs would write the arrays the worker is writing, so such calls are refused
+//Calls from the pipeline itself come from the worker and the task graph threads, or from the game thread within GenerateMap, which blocks blueprints until it is done
+bool AC_MapGenerator::IsRefusedDuringGeneration(const TCHAR* functionName)
+{
+    if (IsInGameThread() && IsGeneratingMap() && GenerationWorker.IsValid()) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("%s called while the map is being generated, ignored"), functionName);
+        return true;
+    }
+    return false;
+}
+
+float AC_MapGenerator::GetGenerationProgress()
+{
+    return GenerationPipeline.IsValid() ? GenerationPipeline->GetProgress() : 0.f;
+}
+
+FString AC_MapGenerator::GetGenerationStage()
+{
+    return GenerationPipeline.IsValid() ? GenerationPipeline->GetCurrentStageName() : FString();
+}
+
+//A generation still running uses the generator, so it is stopped (after its current stages) before the generator goes away
+void AC_MapGenerator::BeginDestroy()
+{
+    if (GenerationWorker.IsValid()) {
+        GenerationPipeline->RequestCancel();
+        GenerationWorker->WaitForCompletion();
+        GenerationWorker.Reset();
+    }
+    Super::BeginDestroy();
+}
+
+FString AC_MapGenerator::GetGenerationTimingsReport()
+{
+    return GenerationPipeline.IsValid() ? GenerationPipeline->GetTimingsReport() : FString();
+}
+
+static uint32 HashStageParameters(const TArray<int32>& parameters, const TArray<float>& floatParameters=TArray<float>())
+{
+    return FCrc::MemCrc32(floatParameters.GetData(), floatParameters.Num()*sizeof(float), FCrc::MemCrc32(parameters.GetData(), parameters.Num()*sizeof(int32)));
+}
+
+//Declares every generation stage, in the order the blueprint used to call them, with the data it reads and writes, and the parameters it depends on
+//The seed and the map size only go with the first stage, as every other stage depends on it
+//Reads list everything a stage looks at, channels it only updates in place included, so its order never hangs on the stages in between
+TSharedPtr<FMapGenerationPipeline> AC_MapGenerator::BuildGenerationPipeline(int32 numberOfRivers)
+{
+    //Starts from a clean state, as some stages add to what is already there
+    ReleaseGenerationData();
+    StartingSpots.Empty();
+    
+    typedef EMapChannel C;
+    TSharedPtr<FMapGenerationPipeline> pipeline=MakeShareable(new FMapGenerationPipeline());
+    pipeline->AddStage(TEXT("Altitude"), C::None, C::Altitude, [this]() {GenerateAltitudeMap();},
+                       HashStageParameters({Seed, mapsizex, mapsizey, (int32)AltitudeMode, LongChainLength, MediumChainLength, ShortChainLength, TinyChainLength, NoiseOctaves},
+                                           {LongChainsPerThousandTiles, MediumChainsPerThousandTiles, ShortChainsPerThousandTiles, TinyChainsPerThousandTiles,
+                                            NoiseFeatureSize, LandShare, MidlandShare, HighlandShare}));
+    pipeline->AddStage(TEXT("LongChains"), C::Altitude, C::Altitude, [this]() {PostProcessLongLandChains();});
+    pipeline->AddStage(TEXT("Lakes"), C::Altitude, C::Altitude | C::Lakes, [this]() {PostProcessLakes();},
+                       HashStageParameters({MaxLakeSize, MaxFilledLakeSize}));
+    pipeline->AddStage(TEXT("Terrain"), C::Altitude | C::Lakes, C::Altitude | C::Terrain | C::TileLists, [this]() {GenerateTerrainType();});
+    pipeline->AddStage(TEXT("Rivers"), C::Altitude | C::Terrain | C::Lakes | C::TileLists, C::Rivers, [this, numberOfRivers]() {BuildRivers(numberOfRivers);},
+                       HashStageParameters({numberOfRivers, (int32)RiverMode, RiverDrainageTiles}));
+    pipeline->AddStage(TEXT("FreshWater"), C::Terrain | C::Rivers, C::FreshWater, [this]() {CheckFreshWater();});
+    pipeline->AddStage(TEXT("Distances"), C::Terrain | C::Rivers, C::Distances, [this]() {BuildDistanceFields();});
+    pipeline->AddStage(TEXT("Deserts"), C::Altitude | C::Terrain | C::TileLists | C::Distances, C::Terrain, [this]() {GenerateDeserts();},
+                       HashStageParameters({(int32)ClimateMode}, {DesertMoisture}));
+    pipeline->AddStage(TEXT("HexTypes"), C::Altitude | C::Terrain, C::HexTypes, [this]() {GetHexTypesAndRotations();});
+    pipeline->AddStage(TEXT("ReduceAltitude"), C::Altitude | C::Terrain | C::Rivers, C::Altitude | C::Rivers, [this]() {ReduceLandAltitude();});
+    pipeline->AddStage(TEXT("Forests"), C::Altitude | C::TileLists | C::Terrain, C::Forests, [this]() {PlaceForests();},
+                       HashStageParameters({(int32)ForestMode}, {ForestDensity}));
+    pipeline->AddStage(TEXT("Resources"), C::Altitude | C::Terrain | C::TileLists | C::Rivers | C::FreshWater | C::Forests, C::Resources, [this]() {PlaceResources();});
+    pipeline->AddStage(TEXT("Improvements"), C::None, C::Improvements, [this]() {PlaceImprovements();});
+    pipeline->AddStage(TEXT("StartingSpots"), C::Altitude | C::Terrain | C::TileLists | C::FreshWater | C::Forests | C::Resources, C::StartingSpots, [this]() {GetStartingSpots();},
+                       HashStageParameters({NumberOfCivs, StartSpotRadius}, {StartSpotCandidateShare}));
+    pipeline->AddStage(TEXT("StartRegions"), C::StartingSpots, C::Regions, [this]() {BuildStartRegions();});
+    pipeline->AddStage(TEXT("ResourceQuotas"), C::Altitude | C::Terrain | C::TileLists | C::FreshWater | C::Forests | C::Resources | C::StartingSpots | C::Regions,
+                       C::Resources | C::StartingSpots, [this]() {PlaceResourceQuotas();},
+                       HashStageParameters({StrategicResourcesPerRegion, LuxuryResourcesPerRegion}));
+    return pipeline;
+}
+
+//Game thread side of the end of a generation
+void AC_MapGenerator::FinishGeneration(int32 numberOfRivers)
+{
+    UE_LOG(LogMapGeneration, Log, TEXT("Generated %dx%d map with seed %d : %s"), mapsizex, mapsizey, UsedSeed, *GenerationPipeline->GetTimingsReport());
+    if (bUseMapCache && (Seed != 0)) {
+        SaveMapCache(numberOfRivers);
+    }
+}
+
+
+//Moves a random walk from 'tile' to one of its neighbors on the map, with a single draw : at the poles, only the neighbors which exist are drawn from
+static FORCEINLINE int32 RandomNeighbor(const FHexNeighborTable& table, int32 tile, FMapRandomStream& random)
+{
+    const int32* neighbors=table.getNeighbors(tile);
+    int32 valid[6];
+    int32 numValid=0;
+    for (int32 j=0; j<6; j++) {
+        if (neighbors[j] != -1) {
+            valid[numValid++]=neighbors[j];
+        }
     }
-    return ArrayPos;
+    return valid[random.RandRange(0, numValid-1)];
 }
 
+//Adds 1 to an altitude other threads may be elevating too, without going over 3; such increments give the same result in any order
+static FORCEINLINE void ElevateTile(volatile int32* altitude)
+{
+    int32 current=*altitude;
+    while (current < 3) {
+        int32 previous=FPlatformAtomics::InterlockedCompareExchange(altitude, current+1, current);
+        if (previous == current) {
+            break;
+        }
+        current=previous;
+    }
+}
 
 //Generates an altitude map for the current instance, in the form of a 1D Array
 //Altitudes : 0=water, 1=lowlands, 2=midlands, 3=highlands
+//Picks the seed first (see Seed)
 void AC_MapGenerator::GenerateAltitudeMap()
 {
+    if (IsRefusedDuringGeneration(TEXT("GenerateAltitudeMap"))) {
+        return;
+    }
     int32 mapsize=mapsizex*mapsizey;
-    AltitudeMap.SetNum(mapsize);
+    BuildNeighborTable();
+    InitializeSeed();
+    AltitudeMap.Init(0, mapsize);
     
-    for (int32 i = 0; i<(mapsize); i++) {
-        AltitudeMap[i]=0;
+    if (AltitudeMode == EAltitudeMode::VE_Noise) {
+        GenerateNoiseAltitudes();
     }
+    else {
+        GenerateChainAltitudes();
+    }
+}
+
+//Chain mode of GenerateAltitudeMap
+void AC_MapGenerator::GenerateChainAltitudes()
+{
+    //Temporaries of the stages go on the FMemStack of their thread, and are all released at once when the stage returns (see FMapGenerationArena for what outlives them)
+    FMemMark Mark(FMemStack::Get());
+    int32 mapsize=mapsizex*mapsizey;
     
-    
-    //Chain mechanism : A certain number of chains of varying lengths will be placed on the map to elevate the altitude of the map; implementation of chains lower
-    int32 const LongChains = 0/*1*/, LengthLong=1000;
-    int32 const MediumChains = 1/*3*/, LengthMedium=400;
-    int32 const ShortChains = 2, LengthShort=100;
-    int32 const TinyChains = 10, LengthTiny=4;
-    int32 const NumberOfChains = LongChains+MediumChains+ShortChains+TinyChains;
-    int32 Chains[NumberOfChains];
-    int32 ChainActual, gridx, gridy;
-    int32 nextDir;
-    //Chain implementation : each chain starts at a random location and elevates terrain there; the getNeighbor function is then used to move to an adjacent tile and elevate it; loops until the chain is finished, then moves on to the next chain
-    for (int32 i=0; i<NumberOfChains; i++) {
-        
-        //Setting length of chains
-        if (i<LongChains) {
-            Chains[i]=randomstream.RandRange(LengthLong/2, LengthLong*3/2);
-        }
-        else if (i<(LongChains+MediumChains)) {
-            Chains[i]=randomstream.RandRange(LengthMedium/2, LengthMedium*3/2);
-        }
-        else if (i<(LongChains+MediumChains+ShortChains)) {
-            Chains[i]=randomstream.RandRange(LengthShort/2, LengthShort*3/2);
+    //Chain mechanism : A certain number of chains of varying lengths will be placed on the map to elevate the altitude of the map; the number of chains grows with the map area
+    int32 const NumberOfClasses = 4;
+    float const ChainsPerThousandTiles[NumberOfClasses] = {LongChainsPerThousandTiles, MediumChainsPerThousandTiles, ShortChainsPerThousandTiles, TinyChainsPerThousandTiles};
+    int32 const ChainLengths[NumberOfClasses] = {LongChainLength, MediumChainLength, ShortChainLength, TinyChainLength};
+    TArray<int32, TMemStackAllocator<>> Chains;//Base length of each chain
+    for (int32 i=0; i<NumberOfClasses; i++) {
+        int32 count=FMath::RoundToInt(ChainsPerThousandTiles[i]*mapsize/1000.f);
+        for (int32 j=0; j<count; j++) {
+            Chains.Add(ChainLengths[i]);
         }
-        else {
-            Chains[i]=randomstream.RandRange(LengthTiny/2, LengthTiny*3/2);
+    }
+    
+    //Chain implementation : each chain starts at a random location and elevates terrain there, then moves to a random adjacent tile and elevates it, until the chain is finished
+    //Chains run in parallel : every chain draws from its own stream and elevations are saturating atomic adds, so the map is the same whatever the number of threads
+    volatile int32* altitudes=AltitudeMap.GetData();
+    const FHexNeighborTable& table=*NeighborTable;
+    ParallelFor(Chains.Num(), [this, &Chains, altitudes, &table, mapsize](int32 i) {
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::AltitudeChains, i);
+        int32 length=random.RandRange(Chains[i]/2, Chains[i]*3/2);
+        int32 ChainActual=random.RandRange(0, mapsize-1);
+        for (int32 j=0; j<length; j++) {
+            ElevateTile(altitudes+ChainActual);
+            ChainActual=RandomNeighbor(table, ChainActual, random);
         }
-        
-        //Setting starting point of current chain
-        ChainActual=randomstream.RandRange(0, mapsize-1);
-        gridx=getX(ChainActual);
-        gridy=getY(ChainActual);
-        
-        for (int32 j=0; j<Chains[i];j++) {
-            if ((AltitudeMap[ChainActual])<3) { //Elevate if not too high
-                AltitudeMap[ChainActual]++;
-            }
-            nextDir=randomstream.RandRange(1, 6);
-            while (getNeighbor(gridx, gridy, nextDir)==-1) { //Handling out-of-map
-                nextDir=randomstream.RandRange(1, 6);
-            }
-            ChainActual=getNeighbor(gridx, gridy, nextDir);
-            gridx=getX(ChainActual);
-            gridy=getY(ChainActual);
-            
+    });
+}
+
+//Noise mode of GenerateAltitudeMap : fractal noise, cut into the 4 altitude levels so that the levels cover LandShare, MidlandShare and HighlandShare of the map
+//Every row is sampled on its own, so the cost only grows with the area of the map
+void AC_MapGenerator::GenerateNoiseAltitudes()
+{
+    FMemMark Mark(FMemStack::Get());
+    int32 mapsize=mapsizex*mapsizey;
+    FHexCylinderNoise noise(mapsizex, UsedSeed, NoiseFeatureSize, NoiseOctaves);
+    TArray<float, TMemStackAllocator<>> values;
+    values.SetNumUninitialized(mapsize);
+    float* rows=values.GetData();
+    ParallelFor(mapsizey, [this, &noise, rows](int32 y) {
+        noise.SampleRow(y, rows+y*mapsizex);
+    });
+    
+    //The cuts are taken from a histogram of the values rather than by sorting them, which keeps the whole mode linear in the map area
+    float minValue=values[0];
+    float maxValue=values[0];
+    for (int32 i=1; i<mapsize; i++) {
+        minValue=FMath::Min(minValue, values[i]);
+        maxValue=FMath::Max(maxValue, values[i]);
+    }
+    int32 const NumberOfBins=4096;
+    float binScale=(maxValue > minValue) ? (NumberOfBins-1)/(maxValue-minValue) : 0.f;
+    TArray<int32, TMemStackAllocator<>> Bins;
+    Bins.SetNumUninitialized(mapsize);
+    TArray<int32, TMemStackAllocator<>> Histogram;
+    Histogram.Init(0, NumberOfBins);
+    for (int32 i=0; i<mapsize; i++) {
+        Bins[i]=(int32)((values[i]-minValue)*binScale);
+        Histogram[Bins[i]]++;
+    }
+    
+    //Lowest bin such that the bins from there up hold 'share' of the map (NumberOfBins if share is 0)
+    auto findCut=[&Histogram, mapsize](float share) {
+        int32 target=FMath::RoundToInt(FMath::Clamp(share, 0.f, 1.f)*mapsize);
+        int32 count=0;
+        for (int32 bin=NumberOfBins-1; bin>=0; bin--) {
+            if (count >= target) {
+                return bin+1;
+            }
+            count+=Histogram[bin];
         }
+        return 0;
+    };
+    int32 landCut=findCut(LandShare);
+    int32 midlandCut=FMath::Max(findCut(MidlandShare), landCut);
+    int32 highlandCut=FMath::Max(findCut(HighlandShare), midlandCut);
+    for (int32 i=0; i<mapsize; i++) {
+        AltitudeMap[i]=(Bins[i] >= landCut) + (Bins[i] >= midlandCut) + (Bins[i] >= highlandCut);
     }
 }
 
 //Post-processes the previously generated altitude map so that there are less long land chains joining continents, creating more bays and islands
+//A long chain tile is a lowland with 4 water neighbors and lowlands only otherwise; tiles outside of the map don't count, so they are read as lowlands
 void AC_MapGenerator::PostProcessLongLandChains() {
+    if (IsRefusedDuringGeneration(TEXT("PostProcessLongLandChains"))) {
+        return;
+    }
     int32 mapsize=mapsizex*mapsizey;
-    TArray<int32> LongChains;
-    for (int32 i=0; i<mapsize; i++) {
-        if (AltitudeMap[i]==1) {
-            int32 NumberOfWaterNeighbors=0;
-            bool isLongChain=true;
-            for (int32 j=0; j<6; j++) {
-                int32 Neighbor=getNeighbor(getX(i), getY(i), j+1);
-                if (Neighbor != -1) {
-                    if (AltitudeMap[Neighbor]==0) {
-                        NumberOfWaterNeighbors++;
-                    }
-                    else if (AltitudeMap[Neighbor]!=1) {
-                        isLongChain=false;
-                        break;
-                    }
-                }
-            }
-            if ((NumberOfWaterNeighbors==4) && isLongChain) {
-                LongChains.Push(i);
-            }
+    TArray<uint8> isLongChain;
+    NeighborTable->ApplyStencil(AltitudeMap, 1, isLongChain, [this](int32 i, const int32* neighbors) {
+        int32 NumberOfWaterNeighbors=0;
+        int32 NumberOfHigherNeighbors=0;
+        for (int32 j=0; j<6; j++) {
+            NumberOfWaterNeighbors+=(neighbors[j]==0);
+            NumberOfHigherNeighbors+=(neighbors[j]>1);
         }
-    }
-    for (int32 i=0; i<LongChains.Num(); i++) {
-        if (randomstream.RandRange(1, 10) < 8) {
-            AltitudeMap[LongChains[i]]--;
+        return (uint8)((AltitudeMap[i]==1) & (NumberOfWaterNeighbors==4) & (NumberOfHigherNeighbors==0));
+    });
+    for (int32 i=0; i<mapsize; i++) {
+        if (isLongChain[i] && (FMapRandom::RandRange(UsedSeed, EMapRandomStage::LongChains, i, 0, 1, 10) < 8)) {
+            AltitudeMap[i]--;
         }
     }
 }
 
 //Post-processes lakes : removes some of them and elevates with land some others. Also fills up the Lakes array
 void AC_MapGenerator::PostProcessLakes() {
+    if (IsRefusedDuringGeneration(TEXT("PostProcessLakes"))) {
+        return;
+    }
+    FMemMark Mark(FMemStack::Get());
     int32 mapsize=mapsizex*mapsizey;
     
-    //Finds all lakes on the map
+    //Lakes of an earlier call stay in the generation arena until it is reset
+    Lakes.Reset();
+    
+    //Finds all lakes on the map : every water body small enough which isn't only deep ocean is a lake; lakes are ordered by their first non ocean tile
+    LabelWaterBodies();
+    TArray<int32, TMemStackAllocator<>> LakeOfBody;
+    LakeOfBody.Init(-1, WaterBodySizes.Num());
     for (int32 i=0; i<mapsize; i++) {
-        if (AltitudeMap[i]==0) {
+        int32 body=WaterBodyOfTile[i];
+        if ((body!=-1) && (LakeOfBody[body]==-1) && (WaterBodySizes[body]<=MaxLakeSize)) {
             if (!CheckIfOcean(i)) {
-                bool isAlreadyLake=false;
-                for (int32 k=0; k<Lakes.Num(); k++) {
-                    if (Lakes[k]->tiles.Contains(i)) {
-                        isAlreadyLake=true;
-                        break;
-                    }
-                }
-                if (!isAlreadyLake) {
-                    WaterBody *potentialLake = new WaterBody();
-                    if (CheckIfLake(i, potentialLake)) {
-                        FString NewString = FString::FromInt(potentialLake->tiles.Num());
-                        Lakes.Push(potentialLake);
-                    }
-                }
+                LakeOfBody[body]=Lakes.Num();
+                WaterBody *potentialLake = GenerationArena.New<WaterBody>();
+                potentialLake->altitude=0;
+                potentialLake->tiles.Reserve(WaterBodySizes[body]);
+                Lakes.Push(potentialLake);
             }
         }
     }
+    for (int32 i=0; i<mapsize; i++) {
+        if ((WaterBodyOfTile[i]!=-1) && (LakeOfBody[WaterBodyOfTile[i]]!=-1)) {
+            Lakes[LakeOfBody[WaterBodyOfTile[i]]]->tiles.Push(i);
+        }
+    }
     
-    //Removes some lakes
+    //Removes some lakes; the bigger the lake, the more likely it gets filled. Lakes bigger than MaxFilledLakeSize tiles (inland seas) are always kept
+    int32 maxFilledSize=FMath::Max(MaxFilledLakeSize, 0);
     for (int32 i=Lakes.Num()-1; i>=0; i--) {
-        if ((randomstream.RandRange(0, 8)) <= Lakes[i]->tiles.Num()) {
+        if ((Lakes[i]->tiles.Num()<=maxFilledSize) && ((FMapRandom::RandRange(UsedSeed, EMapRandomStage::Lakes, Lakes[i]->tiles[0], 0, 0, maxFilledSize)) <= Lakes[i]->tiles.Num())) {
             for (int32 j=0; j<Lakes[i]->tiles.Num(); j++) {
                 AltitudeMap[Lakes[i]->tiles[j]]++;
             }
@@ -250,15 +468,27 @@ void AC_MapGenerator::PostProcessLakes() {
         }
     }
     
+    //Indexes the remaining lakes per tile, for constant time lookups in CheckIfLakeTile
+    LakeOfTile.Init(-1, mapsize);
+    for (int32 i=0; i<Lakes.Num(); i++) {
+        for (int32 j=0; j<Lakes[i]->tiles.Num(); j++) {
+            LakeOfTile[Lakes[i]->tiles[j]]=i;
+        }
+    }
+    
     //Elevates some lakes
+    TArray<int32, TMemStackAllocator<>> CoastOfLake;//Last lake each tile was found on the coast of, to avoid duplicates in LakeCoast
+    CoastOfLake.Init(-1, mapsize);
+    TArray<int32, TMemStackAllocator<>> LakeCoast;
     for (int32 i=0; i<Lakes.Num(); i++) {
-        TArray<int32> LakeCoast;
+        LakeCoast.Reset();
         for (int32 j=0; j<Lakes[i]->tiles.Num(); j++) {
             for (int32 k=0; k<6; k++) {
-                int32 current = getNeighbor(getX(Lakes[i]->tiles[j]), getY(Lakes[i]->tiles[j]), k+1);
+                int32 current = getNeighbor(Lakes[i]->tiles[j], k+1);
                 if (current!=-1) { //Dealing with out-of-map cases
                     if (AltitudeMap[current]!=0) {
-                        if (!(LakeCoast.Contains(current))) {
+                        if (CoastOfLake[current]!=i) {
+                            CoastOfLake[current]=i;
                             LakeCoast.Push(current);
                         }
                     }
@@ -294,48 +524,17 @@ void AC_MapGenerator::PostProcessLakes() {
     }
 }
 
-//Checks if a given waterbody is a lake; a lake has an area equal to or less than 8 tiles
-bool AC_MapGenerator::CheckIfLake(int32 start, WaterBody *lake) {
-    int32 mapsize=mapsizex*mapsizey;
-    TArray<int32> frontier;
-    TArray<int32> visited;
-    
-    frontier.Push(start);
-    
-    //Check if tile is part of a lake
-    while (frontier.Num() != 0) {
-        if (!(visited.Num()<8)) {
-            return false;//water body is too large to be a lake
-        }
-        int32 current=frontier.Pop();
-        visited.Push(current);
-        for (int32 j=1; j<7; j++) {
-            int32 actualNeighbor = getNeighbor(getX(current), getY(current), j);
-            if (actualNeighbor!=-1) {
-                if (AltitudeMap[actualNeighbor]==0) {
-                    if ((!visited.Contains(actualNeighbor)) && !frontier.Contains(actualNeighbor)) {
-                        frontier.Push(actualNeighbor);
-                    }
-                }
-            }
-        }
-    }
-    //If water body is a lake, fill up a WaterBody element
-    for (int32 i=0; i<visited.Num(); i++) {
-        lake->tiles.Push(visited[i]);
-    }
-    lake->altitude=0;
-    return true;
+//Labels every connected water body of the map in one linear pass; fills up WaterBodyOfTile and WaterBodySizes
+void AC_MapGenerator::LabelWaterBodies() {
+    NeighborTable->LabelComponents([this](int32 i) { return AltitudeMap[i]==0; }, WaterBodyOfTile, WaterBodySizes);
 }
 
 //Checks if hex "i" is a lake tile, and returns its altitude; returns -1 if not a lake
 int32 AC_MapGenerator::CheckIfLakeTile(int32 i) {
-    for (int j=0; j<Lakes.Num(); j++) {
-        if (Lakes[j]->tiles.Contains(i)) {
-            return Lakes[j]->altitude;
-        }
+    if ((i==-1) || (LakeOfTile[i]==-1)) {
+        return -1;
     }
-    return -1;
+    return Lakes[LakeOfTile[i]]->altitude;
 }
 
 //Checks whether a given water hex is a deepwater ocean tile
@@ -347,7 +546,7 @@ bool AC_MapGenerator::CheckIfOcean(int32 i){
     }
     int32 currentNeighbor;
     for (int32 j=1; j<7; j++) {
-        currentNeighbor=getNeighbor(getX(i), getY(i), j);
+        currentNeighbor=getNeighbor(i, j);
         if (currentNeighbor != -1) {
             if (AltitudeMap[currentNeighbor] != 0) {
                 isOcean=false;
@@ -358,6 +557,17 @@ bool AC_MapGenerator::CheckIfOcean(int32 i){
     return isOcean;
 }
 
+//CheckIfOcean for every tile at once : outOcean gets 1 for deepwater ocean tiles, 0 for the others
+void AC_MapGenerator::ComputeOceanTiles(TArray<uint8>& outOcean){
+    NeighborTable->ApplyStencil(AltitudeMap, 0, outOcean, [this](int32 i, const int32* neighbors) {
+        int32 NumberOfLandNeighbors=0;
+        for (int32 j=0; j<6; j++) {
+            NumberOfLandNeighbors+=(neighbors[j]!=0);
+        }
+        return (uint8)((AltitudeMap[i]==0) & (NumberOfLandNeighbors==0));
+    });
+}
+
 
 
 //Computes an "apparent latitude" for climate based on latitude and elevation
@@ -433,49 +643,60 @@ int32 AC_MapGenerator::getGrassWeight(int32 latitude){
 //Generates terrain types : grassland, tundra, snow, etc. Also fills up the LandTiles and WaterTiles arrays. Does not place deserts; these will be placed later when rivers are placed.
 void AC_MapGenerator::GenerateTerrainType()
 {
+    if (IsRefusedDuringGeneration(TEXT("GenerateTerrainType"))) {
+        return;
+    }
     int32 mapsize = mapsizex*mapsizey;
-    int32 latitude, applatitude, snowWeight, tundraWeight, plainWeight, grassWeight, totalWeight;
-    int32 weightedRandomFactor;
+    int32 snowLatitude = getLatitude(0)*5/6;
     
     TerrainType.SetNum(mapsize);
+    TArray<uint8> isOcean;
+    ComputeOceanTiles(isOcean);
     
-    for (int32 i=0; i<mapsize; i++) {
-        if (AltitudeMap[i]==0) {
-            TerrainType[i]=ETerrain::VE_Coast;
-            WaterTiles.Push(i);
-            if (CheckIfOcean(i)) {
-                TerrainType[i]=ETerrain::VE_Ocean;
-            }
-        }
-        else {
-            applatitude = getApparentLatitude(i);
-            
-            snowWeight = getSnowWeight(applatitude);
-            tundraWeight = getTundraWeight(applatitude);
-            plainWeight = getPlainWeight(applatitude);
-            grassWeight = getGrassWeight(applatitude);
-            totalWeight = snowWeight + tundraWeight + plainWeight + grassWeight;
-            weightedRandomFactor= randomstream.RandRange(0, totalWeight-1);
-            if (weightedRandomFactor<grassWeight) {
-                TerrainType[i]=ETerrain::VE_Grassland;
-            }
-            else if (weightedRandomFactor<(grassWeight+plainWeight)){
-                TerrainType[i]=ETerrain::VE_Plain;
+    //Every tile draws its own terrain, so rows are done in parallel
+    ParallelFor(mapsizey, [this, snowLatitude, &isOcean](int32 y) {
+        for (int32 i=y*mapsizex; i<(y+1)*mapsizex; i++) {
+            if (AltitudeMap[i]==0) {
+                TerrainType[i]=ETerrain::VE_Coast;
+                if (isOcean[i]) {
+                    TerrainType[i]=ETerrain::VE_Ocean;
+                }
             }
-            else if (weightedRandomFactor<(grassWeight+plainWeight+tundraWeight)){
-                TerrainType[i]=ETerrain::VE_Tundra;
+            else if (getLatitude(i) > snowLatitude) {//Polar land is always snow
+                TerrainType[i]=ETerrain::VE_Snow;
             }
             else {
-                TerrainType[i]=ETerrain::VE_Snow;
+                int32 applatitude = getApparentLatitude(i);
+                
+                int32 snowWeight = getSnowWeight(applatitude);
+                int32 tundraWeight = getTundraWeight(applatitude);
+                int32 plainWeight = getPlainWeight(applatitude);
+                int32 grassWeight = getGrassWeight(applatitude);
+                int32 totalWeight = snowWeight + tundraWeight + plainWeight + grassWeight;
+                int32 weightedRandomFactor = FMapRandom::RandRange(UsedSeed, EMapRandomStage::Terrain, i, 0, 0, totalWeight-1);
+                if (weightedRandomFactor<grassWeight) {
+                    TerrainType[i]=ETerrain::VE_Grassland;
+                }
+                else if (weightedRandomFactor<(grassWeight+plainWeight)){
+                    TerrainType[i]=ETerrain::VE_Plain;
+                }
+                else if (weightedRandomFactor<(grassWeight+plainWeight+tundraWeight)){
+                    TerrainType[i]=ETerrain::VE_Tundra;
+                }
+                else {
+                    TerrainType[i]=ETerrain::VE_Snow;
+                }
             }
-            LandTiles.Push(i);
         }
-    }
+    });
     
-    for (int32 i=0; i<LandTiles.Num(); i++) {
-        latitude=getLatitude(LandTiles[i]);
-        if (latitude > getLatitude(0)*5/6) {
-            TerrainType[LandTiles[i]]=ETerrain::VE_Snow;
+    //Tile lists stay in map order
+    for (int32 i=0; i<mapsize; i++) {
+        if (AltitudeMap[i]==0) {
+            WaterTiles.Push(i);
+        }
+        else {
+            LandTiles.Push(i);
         }
     }
     
@@ -489,6 +710,8 @@ void AC_MapGenerator::GenerateTerrainType()
 }
 
 //Utility functions to access river information in blueprint
+bool AC_MapGenerator::IsRiverOn(int32 index, int32 dir) {return (RiverEdges[index] & FHexNeighborTable::EdgeBit(dir)) != 0;}
+bool AC_MapGenerator::IsNextToRiver(int32 index) {return RiverEdges[index] != 0;}
 int32 AC_MapGenerator::getTotalNumberOfRiverSegments() {return Rivers.Num();}
 TArray<int32> AC_MapGenerator::getLeftBankArray(int32 i) {return Rivers[i]->LeftBank;}
 TArray<int32> AC_MapGenerator::getRightBankArray(int32 i) {return Rivers[i]->RightBank;}
@@ -497,33 +720,91 @@ int32 AC_MapGenerator::getSegAltitude(int32 i) {return Rivers[i]->segAltitude;}
 int32 AC_MapGenerator::getSegStart(int32 i) {return Rivers[i]->segStart;}
 int32 AC_MapGenerator::getSegEnd(int32 i) {return Rivers[i]->segEnd;}
 
+//Rebuilds one of the former per side river arrays : 1 where there is a river on side 'dir' of the tile, 0 otherwise
+TArray<int32> AC_MapGenerator::getRiverOnArray(int32 dir)
+{
+    TArray<int32> RiverOn;
+    RiverOn.SetNum(RiverEdges.Num());
+    uint8 bit=FHexNeighborTable::EdgeBit(dir);
+    for (int32 i=0; i<RiverEdges.Num(); i++) {
+        RiverOn[i]=((RiverEdges[i] & bit) != 0) ? 1 : 0;
+    }
+    return RiverOn;
+}
+
+void AC_MapGenerator::SetRiverOn(int32 index, int32 dir, bool bRiver)
+{
+    if (bRiver) {
+        NeighborTable->SetEdge(RiverEdges, index, dir);
+    }
+    else {
+        NeighborTable->ClearEdge(RiverEdges, index, dir);
+    }
+}
+
 
-//Places all rivers on the map
+//Places all rivers on the map, as set by RiverMode
 //Must be placed after GenerateTerrainType but before GenerateDeserts
 void AC_MapGenerator::BuildRivers(int32 numberOfRivers)
 {
+    if (IsRefusedDuringGeneration(TEXT("BuildRivers"))) {
+        return;
+    }
+    //Counts how many times each tile is a bank of a placed river segment, so that bank lookups don't have to go through all segments
+    int32 mapsize = mapsizex*mapsizey;
+    LeftBankCount.Init(0, mapsize);
+    RightBankCount.Init(0, mapsize);
+    for (int32 i=0; i<Rivers.Num(); i++) {
+        for (int32 j=0; j<Rivers[i]->LeftBank.Num(); j++) {
+            LeftBankCount[Rivers[i]->LeftBank[j]]++;
+            RightBankCount[Rivers[i]->RightBank[j]]++;
+        }
+    }
+    
+    if (RiverMode==ERiverMode::VE_Flow) {
+        BuildFlowRivers(numberOfRivers);
+    }
+    else {
+        BuildRandomWalkRivers(numberOfRivers);
+    }
+    
+    //Fills up RiverEdges for pathfinding (and desert placement); every bank pair marks the edge on both of its tiles
+    RiverEdges.Init(0, mapsize);
+    for (int32 i=0; i<Rivers.Num(); i++) {
+        for (int32 j=0; j<Rivers[i]->LeftBank.Num(); j++) {
+            Rivers[i]->dir[j]=FHexNeighborTable::WrapDirection(Rivers[i]->dir[j])+1;
+            NeighborTable->SetEdge(RiverEdges, Rivers[i]->LeftBank[j], Rivers[i]->dir[j]);
+        }
+    }
+}
+
+//Starts rivers from random spots of the coast, and has them walk up the land
+void AC_MapGenerator::BuildRandomWalkRivers(int32 numberOfRivers)
+{
+    FMemMark Mark(FMemStack::Get());
     //First part of function checks eligible spots to start a river
-    TArray<int32> PotentialStartLeftBank;
-    TArray<int32> PotentialStartRightBank;
-    TArray<int32> PotentialStartDir;
+    TArray<int32, TMemStackAllocator<>> PotentialStartLeftBank;
+    TArray<int32, TMemStackAllocator<>> PotentialStartRightBank;
+    TArray<int32, TMemStackAllocator<>> PotentialStartDir;
     for (int32 i=0; i<LandTiles.Num(); i++) {
         for (int32 j=0; j<7; j++) {
             if (CheckIfEligibleRiverStart(LandTiles[i], j)) {
                 PotentialStartLeftBank.Push(LandTiles[i]);
-                PotentialStartRightBank.Push(getNeighbor(getX(LandTiles[i]), getY(LandTiles[i]), j));
+                PotentialStartRightBank.Push(getNeighbor(LandTiles[i], j));
                 PotentialStartDir.Push(j);
             }
         }
     }
     
-    TArray<int32> StartLeftBank;
-    TArray<int32> StartRightBank;
-    TArray<int32> StartDir;
+    TArray<int32, TMemStackAllocator<>> StartLeftBank;
+    TArray<int32, TMemStackAllocator<>> StartRightBank;
+    TArray<int32, TMemStackAllocator<>> StartDir;
     
     //Selects some of the previous eligible spots to actually become river starts
+    FMapRandomStream random=GetRandomStream(EMapRandomStage::RiverStarts, 0);
     for (int32 i=0; i<numberOfRivers; i++) {
         if (PotentialStartLeftBank.Num() > 0) {
-            int32 selected = randomstream.RandRange(1, PotentialStartLeftBank.Num()) - 1;
+            int32 selected = random.RandRange(1, PotentialStartLeftBank.Num()) - 1;
             StartLeftBank.Push(PotentialStartLeftBank[selected]);
             StartRightBank.Push(PotentialStartRightBank[selected]);
             StartDir.Push(PotentialStartDir[selected]);
@@ -532,108 +813,257 @@ void AC_MapGenerator::BuildRivers(int32 numberOfRivers)
             PotentialStartDir.RemoveAt(selected);
         }
         else {
-            if (GEngine) {
-                GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, TEXT("no more river spots"));
-            }
+            UE_LOG(LogMapGeneration, Verbose, TEXT("no more river spots"));
         }
     }
     
     //Create a river segment for each of the selected spots; each river segment may develop into more segments as the river gains in altitude or forks
+    //Every river draws from a stream keyed on where it starts
     while (StartLeftBank.Num() != 0) {
+        RiverRandom=GetRandomStream(EMapRandomStage::Rivers, StartLeftBank.Last()*7 + StartDir.Last());
         BuildRiverSegment(StartLeftBank.Pop(), StartRightBank.Pop(), StartDir.Pop(), 0, true, 0);
     }
+}
+
+//Highest altitude level the flow mode knows; lakes and land are never above it
+static const int32 MaxFlowLevel = 3;
+
+//Rivers as the drainage of the land : every tile corner sends its rain down to one of its neighboring corners, and rivers go wherever enough rain gathers
+//Rivers run on tile sides, so the flow runs from corner to corner; a river side of tile L towards its 'dir' neighbor goes up from corner dir-1 to corner dir of L
+//Corners on the coast or on a lake shore, with a single side between two land tiles, are the river mouths; every other corner drains towards them
+//The drainage is a priority flood from the mouths : corners are reached in order of the lowest level the water has to go over to get there, then of distance, which only takes
+//a FIFO per altitude level (a counting sort on both); corners left in a hollow drain over its lowest rim. Reversing that order gives the flow accumulation in linear time
+//The river mouths draining the most become rivers, so that there are at most numberOfRivers of them; the cost is the same for any number of rivers
+void AC_MapGenerator::BuildFlowRivers(int32 numberOfRivers)
+{
+    FMemMark Mark(FMemStack::Get());
+    auto isWater=[this](int32 tile) {
+        return (TerrainType[tile]==ETerrain::VE_Coast) || (TerrainType[tile]==ETerrain::VE_Ocean) || (TerrainType[tile]==ETerrain::VE_Lake);
+    };
     
-    //Fills up RiverOn* arrays for pathfinding (and desert placement)
-    //First filling with 0s
-    int32 mapsize = mapsizex*mapsizey;
-    RiverOn1.SetNum(mapsize);
-    RiverOn2.SetNum(mapsize);
-    RiverOn3.SetNum(mapsize);
-    RiverOn4.SetNum(mapsize);
-    RiverOn5.SetNum(mapsize);
-    RiverOn6.SetNum(mapsize);
-    for (int32 i=0; i<mapsize; i++) {
-        RiverOn1[i]=0;
-        RiverOn2[i]=0;
-        RiverOn3[i]=0;
-        RiverOn4[i]=0;
-        RiverOn5[i]=0;
-        RiverOn6[i]=0;
-    }
+    //Side reached by every corner (tile and direction, as a river bank pair) and the corner it comes from, i.e. drains to
+    int32 numberOfCorners=NeighborTable->NumCorners();
+    TArray<int32, TMemStackAllocator<>> downstream;
+    TArray<int32, TMemStackAllocator<>> sideTile;
+    TArray<int32, TMemStackAllocator<>> sideDir;
+    downstream.Init(-1, numberOfCorners);
+    sideTile.Init(-1, numberOfCorners);
+    sideDir.Init(0, numberOfCorners);
+    TArray<int32, TMemStackAllocator<>> levelQueues[MaxFlowLevel+1];
+    TArray<int32, TMemStackAllocator<>> mouths;
     
-    //Then actually filling with pertinent data
-    for (int32 i=0; i<Rivers.Num(); i++) {
-        for (int32 j=0; j<Rivers[i]->LeftBank.Num(); j++) {
-            while (Rivers[i]->dir[j] > 6) {
-                Rivers[i]->dir[j]= Rivers[i]->dir[j] - 6;
+    //River mouths; a corner is named by its two tiles of index 'tile' (corners 1 and 2), so every corner is seen once
+    for (int32 tile=0; tile<mapsizex*mapsizey; tile++) {
+        for (int32 dir=1; dir<3; dir++) {
+            int32 corner=NeighborTable->getCorner(tile, dir);
+            if (corner==-1) {
+                continue;
+            }
+            int32 first=getNeighbor(tile, dir);
+            int32 second=getNeighbor(tile, dir+1);
+            int32 water=-1;
+            int32 left=-1;
+            int32 leftDir=0;
+            //The mouth side goes up from the corner, with the water on its right going up, i.e. the 'dir-1' neighbor of its left bank
+            if (isWater(tile) && !isWater(first) && !isWater(second)) {
+                water=tile;
+                left=second;
+                leftDir=dir+5;
+            }
+            else if (!isWater(tile) && isWater(first) && !isWater(second)) {
+                water=first;
+                left=tile;
+                leftDir=dir+1;
+            }
+            else if (!isWater(tile) && !isWater(first) && isWater(second)) {
+                water=second;
+                left=first;
+                leftDir=dir+3;
+            }
+            if (water != -1) {
+                int32 level=(TerrainType[water]==ETerrain::VE_Lake) ? FMath::Clamp(AltitudeMap[water], 0, MaxFlowLevel) : 0;
+                downstream[corner]=corner;
+                sideTile[corner]=left;
+                sideDir[corner]=FHexNeighborTable::WrapDirection(leftDir)+1;
+                levelQueues[level].Push(corner);
             }
-            while (Rivers[i]->dir[j] < 1) {
-                Rivers[i]->dir[j]= Rivers[i]->dir[j] + 6;
+        }
+    }
+    
+    //Priority flood up from the mouths; at a corner reached through the side (L, dir), the river can go on to the left (L, dir+1) or to the right (G, dir-1), G being the third tile of the corner
+    TArray<int32, TMemStackAllocator<>> floodOrder;
+    floodOrder.Reserve(numberOfCorners);
+    for (int32 level=0; level<=MaxFlowLevel; level++) {
+        TArray<int32, TMemStackAllocator<>>& queue=levelQueues[level];
+        for (int32 head=0; head<queue.Num(); head++) {
+            int32 corner=queue[head];
+            floodOrder.Push(corner);
+            int32 left=sideTile[corner];
+            int32 dir=sideDir[corner];
+            int32 upstreamLeft[2]={left, getNeighbor(left, dir+1)};
+            int32 upstreamDir[2]={dir+1, dir-1};
+            int32 numberOfSides=2;
+            int32 firstSide=0;
+            if (downstream[corner]==corner) {//Mouth : only its own side
+                upstreamDir[0]=dir;
+                numberOfSides=1;
             }
-            switch (Rivers[i]->dir[j]) {
-                case 1:
-                    RiverOn1[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn4[Rivers[i]->RightBank[j]]=1;
-                    break;
-                case 2:
-                    RiverOn2[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn5[Rivers[i]->RightBank[j]]=1;
-                    break;
-                case 3:
-                    RiverOn3[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn6[Rivers[i]->RightBank[j]]=1;
-                    break;
-                case 4:
-                    RiverOn4[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn1[Rivers[i]->RightBank[j]]=1;
-                    break;
-                case 5:
-                    RiverOn5[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn2[Rivers[i]->RightBank[j]]=1;
-                    break;
-                case 6:
-                    RiverOn6[Rivers[i]->LeftBank[j]]=1;
-                    RiverOn3[Rivers[i]->RightBank[j]]=1;
-                    break;
-                default:
-                    if (GEngine) {
-                        GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, TEXT("HELLO RIVERS"));
-                    }
-                    break;
+            else {
+                //Which side gets to drain first is drawn, so that rivers crossing flat land meander
+                firstSide=FMapRandom::RandRange(UsedSeed, EMapRandomStage::Rivers, corner, 0, 0, 1);
+            }
+            for (int32 j=0; j<numberOfSides; j++) {
+                int32 bankLeft=upstreamLeft[(firstSide+j)%2];
+                int32 bankDir=upstreamDir[(firstSide+j)%2];
+                int32 next=NeighborTable->getCorner(bankLeft, bankDir);
+                if ((next==-1) || (downstream[next] != -1)) {
+                    continue;
+                }
+                int32 bankRight=getNeighbor(bankLeft, bankDir);
+                if (isWater(bankLeft) || isWater(bankRight)) {
+                    continue;
+                }
+                int32 sideLevel=FMath::Clamp(FMath::Min(AltitudeMap[bankLeft], AltitudeMap[bankRight]), 0, MaxFlowLevel);
+                downstream[next]=corner;
+                sideTile[next]=bankLeft;
+                sideDir[next]=FHexNeighborTable::WrapDirection(bankDir)+1;
+                levelQueues[FMath::Max(level, sideLevel)].Push(next);
             }
         }
     }
-}
-
-//Returns true if "i" is already on left bank of a river, false otherwise
-bool AC_MapGenerator::CheckifAlreadyInLeftBank(int32 i){
-    for (int32 j=0; j<Rivers.Num(); j++) {
-        if (Rivers[j]->LeftBank.Contains(i)) {
-            return true;
+    
+    //Flow accumulation : every corner drains one unit of rain, two per tile, and hands what it gathered down; the flood order has every corner after the one it drains to
+    TArray<int32, TMemStackAllocator<>> flow;
+    flow.Init(0, numberOfCorners);
+    for (int32 i=floodOrder.Num()-1; i>=0; i--) {
+        int32 corner=floodOrder[i];
+        flow[corner]++;
+        if (downstream[corner] != corner) {
+            flow[downstream[corner]]+=flow[corner];
+        }
+        else {
+            mouths.Push(corner);
+        }
+    }
+    
+    //Rivers have to drain at least RiverDrainageTiles, and only the numberOfRivers mouths draining the most get one; the smallest of them sets how much the rest of the rivers drain
+    int32 threshold=FMath::Max(2*RiverDrainageTiles, 2);
+    mouths.Sort([&flow](int32 a, int32 b) {
+        return (flow[a] != flow[b]) ? (flow[a] > flow[b]) : (a < b);
+    });
+    mouths.SetNum(FMath::Clamp(numberOfRivers, 0, mouths.Num()));
+    if (mouths.Num() != 0) {
+        threshold=FMath::Max(threshold, flow[mouths.Last()]);
+    }
+    
+    //River sides are the sides draining to the corner the river comes from, with enough flow; it stops where it would have to go down
+    auto isRiverSide=[&](int32 bankLeft, int32 bankDir, int32 from, int32 altitude) {
+        int32 next=NeighborTable->getCorner(bankLeft, bankDir);
+        if ((next==-1) || (downstream[next]!=from) || (flow[next]<threshold)) {
+            return false;
+        }
+        int32 bankRight=getNeighbor(bankLeft, bankDir);
+        return FMath::Min(AltitudeMap[bankLeft], AltitudeMap[bankRight]) >= altitude;
+    };
+    
+    //Segments are built in the same order as the random walk rivers : up from the mouth, the right fork before the left one
+    struct FSegmentStart {
+        int32 left;
+        int32 right;
+        int32 dir;
+        int32 initstate;
+        int32 waterAltitude;//-1 if the segment doesn't start from water
+    };
+    TArray<FSegmentStart, TMemStackAllocator<>> pending;
+    for (int32 i=mouths.Num()-1; i>=0; i--) {
+        int32 mouth=mouths[i];
+        int32 left=sideTile[mouth];
+        int32 dir=sideDir[mouth];
+        if (flow[mouth]<threshold) {
+            continue;
+        }
+        int32 water=getNeighbor(left, dir-1);
+        bool lake=(TerrainType[water]==ETerrain::VE_Lake);
+        pending.Push({left, getNeighbor(left, dir), dir, lake ? 4 : 0, lake ? AltitudeMap[water] : 0});
+    }
+    while (pending.Num() != 0) {
+        FSegmentStart start=pending.Pop();
+        RiverSegment *actualSeg=BeginRiverSegment(start.left, start.right, start.dir, start.initstate, start.waterAltitude != -1, start.waterAltitude).segment;
+        while (true) {
+            int32 left=actualSeg->LeftBank.Last();
+            int32 right=actualSeg->RightBank.Last();
+            int32 dir=actualSeg->dir.Last();
+            int32 corner=NeighborTable->getCorner(left, dir);
+            int32 third=getNeighbor(left, dir+1);
+            if (third==-1) {
+                actualSeg->segEnd=0;
+                break;
+            }
+            bool goesLeft=isRiverSide(left, dir+1, corner, actualSeg->segAltitude);
+            bool goesRight=isRiverSide(third, dir-1, corner, actualSeg->segAltitude);
+            if (goesLeft && goesRight) {
+                actualSeg->segEnd=1;
+                pending.Push({left, third, FHexNeighborTable::WrapDirection(dir+1)+1, 1, -1});
+                pending.Push({third, right, FHexNeighborTable::WrapDirection(dir-1)+1, 1, -1});
+                break;
+            }
+            if (!goesLeft && !goesRight) {
+                actualSeg->segEnd=0;//Source
+                break;
+            }
+            int32 nextLeft=goesLeft ? left : third;
+            int32 nextRight=goesLeft ? third : right;
+            int32 nextDir=FHexNeighborTable::WrapDirection(goesLeft ? dir+1 : dir-1)+1;
+            int32 climbLeft=AltitudeMap[nextLeft]-actualSeg->segAltitude;
+            int32 climbRight=AltitudeMap[nextRight]-actualSeg->segAltitude;
+            if ((climbLeft > 0) && (climbRight > 0)) {//Both banks higher : the river comes down a cascade, or a waterfall for two levels
+                int32 climb=((climbLeft==2) && (climbRight==2)) ? 3 : 2;
+                actualSeg->segEnd=climb;
+                pending.Push({nextLeft, nextRight, nextDir, climb, -1});
+                break;
+            }
+            PushRiverBanks(actualSeg, nextLeft, nextRight, nextDir);
         }
     }
-    return false;
 }
 
 //Returns true if "i" is already on left bank of a river, false otherwise
+bool AC_MapGenerator::CheckifAlreadyInLeftBank(int32 i){
+    return LeftBankCount[i] > 0;
+}
+
+//Returns true if "i" is already on right bank of a river, false otherwise
 bool AC_MapGenerator::CheckifAlreadyInRightBank(int32 i){
-    for (int32 j=0; j<Rivers.Num(); j++) {
-        if (Rivers[j]->RightBank.Contains(i)) {
-            return true;
-        }
+    return RightBankCount[i] > 0;
+}
+
+//Adds a left/right bank pair at the end of a river segment, and counts it if the segment is on the map
+void AC_MapGenerator::PushRiverBanks(RiverSegment *seg, int32 left, int32 right, int32 direction)
+{
+    seg->LeftBank.Push(left);
+    seg->RightBank.Push(right);
+    seg->dir.Push(direction);
+    if (!seg->removed) {
+        LeftBankCount[left]++;
+        RightBankCount[right]++;
     }
-    return false;
 }
 
-//Builds a river segment. A river segment is here understood to be any segment of continuous river between possible ending points : change of altitude, beginning and end of river, fork. Builds an element to put int the Rivers array, then checks if it should put further segments if it ended with a change of altitude (up) or a fork.
-//startLeft is the first left bank of the river
-//startRight is the first right bank of the river
-//startDir is the first direction to go from left to right bank
-//initstate is the starting state of the segment : 0=ocean, 1=fork, 2=cascade (altitude change of 1), 3=waterfall (altitude change of 2), 4=lake
-//Everything is the same for endings, except 0=source
-bool AC_MapGenerator::BuildRiverSegment(int32 startLeft, int32 startRight, int32 startDir, int32 initstate, bool waterStart, int32 waterStartAltitude)
+//Takes the last segment out of the Rivers array; it stays in the generation arena, as a pending segment might still point to it
+void AC_MapGenerator::RemoveLastRiverSegment()
+{
+    RiverSegment *seg = Rivers.Pop();
+    for (int32 i=0; i<seg->LeftBank.Num(); i++) {
+        LeftBankCount[seg->LeftBank[i]]--;
+        RightBankCount[seg->RightBank[i]]--;
+    }
+    seg->removed=true;
+}
+
+//Creates a new river segment, puts it in the Rivers array and returns the state needed to build it; see BuildRiverSegment for parameters
+RiverBuildFrame AC_MapGenerator::BeginRiverSegment(int32 startLeft, int32 startRight, int32 startDir, int32 initstate, bool waterStart, int32 waterStartAltitude)
 {
-    RiverSegment *actualSeg = new RiverSegment(startLeft, startRight, startDir, initstate);
+    RiverSegment *actualSeg = GenerationArena.New<RiverSegment>(startLeft, startRight, startDir, initstate);
     if (AltitudeMap[startLeft]<=AltitudeMap[startRight]) {
         actualSeg->segAltitude=AltitudeMap[startLeft];
     }
@@ -644,243 +1074,181 @@ bool AC_MapGenerator::BuildRiverSegment(int32 startLeft, int32 startRight, int32
         actualSeg->segStart=3;
     }
     Rivers.Push(actualSeg);
+    LeftBankCount[startLeft]++;
+    RightBankCount[startRight]++;
+    return RiverBuildFrame(actualSeg, startLeft, startRight);
+}
 
-    
-    bool anotherLoop=true;
-    while (anotherLoop) {
-        int32 goingTowards=getNeighbor(getX(actualSeg->LeftBank.Last()), getY(actualSeg->LeftBank.Last()), actualSeg->dir.Last()+1);
-        if (goingTowards!=-1) {//REDUNDANCY CHECKS :D
-            
-            if ((CheckifAlreadyInLeftBank(goingTowards) && CheckifAlreadyInRightBank(startLeft)) ||
-                (CheckifAlreadyInRightBank(goingTowards) && CheckifAlreadyInLeftBank(startRight))) {
-                Rivers.RemoveAt(Rivers.Num()-1);
-                return false; //Case where a river can't start where it was supposed to because of another river having already taken its place
-            }
-            
-            int32 goingToLeft=getNeighbor(getX(actualSeg->LeftBank.Last()), getY(actualSeg->LeftBank.Last()), actualSeg->dir.Last()+2);
-            int32 goingToRight=getNeighbor(getX(actualSeg->RightBank.Last()), getY(actualSeg->RightBank.Last()), actualSeg->dir.Last()+1);
-            int32 nextTurn=0;//1=right, 2=left, 3=random, 4=end, 5=hit a lake
-            if (CheckIfLakeTile(goingTowards) != -1) {
-                nextTurn=5;
-            }
-            else if (goingToLeft == -1) {
-                if ((((AltitudeMap[goingToRight]>=AltitudeMap[actualSeg->RightBank.Last()]) ||
-                    (AltitudeMap[goingToRight]>=AltitudeMap[goingTowards])) &&
-                    (!CheckifAlreadyInRightBank(goingToRight)) && (!CheckifAlreadyInRightBank(goingTowards))) ||
-                    (CheckIfLakeTile(goingToRight)>=(AltitudeMap[goingTowards]-1)) ||
-                    (CheckIfLakeTile(goingToRight)>=(AltitudeMap[actualSeg->RightBank.Last()]-1))) {
-                    nextTurn=1;
-                }
-                else {
-                    nextTurn=4;
-                }
-            }
-            else if (goingToRight == -1) {
-                if ((((AltitudeMap[goingToLeft]>=AltitudeMap[actualSeg->LeftBank.Last()]) ||
-                    (AltitudeMap[goingToLeft]>=AltitudeMap[goingTowards])) &&
-                    (!CheckifAlreadyInLeftBank(goingToLeft)) && (!CheckifAlreadyInLeftBank(goingTowards))) ||
-                    (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[goingTowards]-1)) ||
-                    (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[actualSeg->LeftBank.Last()]-1))) {
-                    nextTurn=2;
-                }
-                else {
-                    nextTurn=4;
-                }
-            }
-            else {
-                if ((((AltitudeMap[goingToRight]>=AltitudeMap[actualSeg->RightBank.Last()]) ||
-                    (AltitudeMap[goingToRight]>=AltitudeMap[goingTowards])) &&
-                    (!CheckifAlreadyInRightBank(goingToRight)) && (!CheckifAlreadyInRightBank(goingTowards))) ||
-                    (CheckIfLakeTile(goingToRight)>=(AltitudeMap[goingTowards]-1)) ||
-                    (CheckIfLakeTile(goingToRight)>=(AltitudeMap[actualSeg->RightBank.Last()]-1))) {
-                    if ((((AltitudeMap[goingToLeft]>=AltitudeMap[actualSeg->LeftBank.Last()]) ||
-                        (AltitudeMap[goingToLeft]>=AltitudeMap[goingTowards])) &&
-                        (!CheckifAlreadyInLeftBank(goingToLeft)) && (!CheckifAlreadyInLeftBank(goingTowards))) ||
-                        (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[goingTowards]-1)) ||
-                        (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[actualSeg->LeftBank.Last()]-1))) {
-                        nextTurn=3;
-                    }
-                    else {
-                        nextTurn=1;
-                    }
-                }
-                else if ((((AltitudeMap[goingToLeft]>=AltitudeMap[actualSeg->LeftBank.Last()]) ||
-                         (AltitudeMap[goingToLeft]>=AltitudeMap[goingTowards])) &&
-                         (!CheckifAlreadyInLeftBank(goingToLeft)) && (!CheckifAlreadyInLeftBank(goingTowards))) ||
-                         (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[goingTowards]-1)) ||
-                         (CheckIfLakeTile(goingToLeft)>=(AltitudeMap[actualSeg->LeftBank.Last()]-1))) {
-                    nextTurn=2;
-                }
-                else {
-                    nextTurn=4;
-                }
+//Builds a river segment. A river segment is here understood to be any segment of continuous river between possible ending points : change of altitude, beginning and end of river, fork. Builds an element to put int the Rivers array, then checks if it should put further segments if it ended with a change of altitude (up) or a fork.
+//startLeft is the first left bank of the river
+//startRight is the first right bank of the river
+//startDir is the first direction to go from left to right bank
+//initstate is the starting state of the segment : 0=ocean, 1=fork, 2=cascade (altitude change of 1), 3=waterfall (altitude change of 2), 4=lake
+//Everything is the same for endings, except 0=source
+//Segments started by other segments are built depth first from an explicit stack, in the same order (and with the same random draws) as nested calls would
+bool AC_MapGenerator::BuildRiverSegment(int32 startLeft, int32 startRight, int32 startDir, int32 initstate, bool waterStart, int32 waterStartAltitude)
+{
+    FMemMark Mark(FMemStack::Get());
+    TArray<RiverBuildFrame, TMemStackAllocator<>> pending;
+    pending.Push(BeginRiverSegment(startLeft, startRight, startDir, initstate, waterStart, waterStartAltitude));
+    bool lastResult=true;//Result of the last finished segment, handed back to the segment which started it
+    while (pending.Num() != 0) {
+        RiverBuildFrame started;
+        int32 outcome=GrowRiverSegment(pending.Last(), lastResult, started);
+        if (outcome==2) {
+            pending.Push(started);
+        }
+        else {
+            lastResult=(outcome==1);
+            pending.Pop();
+        }
+    }
+    return lastResult;
+}
+
+//Checks if the river can turn around the last bank tile "bankLast" towards "next", on its right side (rightSide) or its left side
+bool AC_MapGenerator::CheckIfRiverCanTurn(int32 next, int32 bankLast, int32 goingTowards, bool rightSide)
+{
+    bool nextOnBank = rightSide ? CheckifAlreadyInRightBank(next) : CheckifAlreadyInLeftBank(next);
+    bool towardsOnBank = rightSide ? CheckifAlreadyInRightBank(goingTowards) : CheckifAlreadyInLeftBank(goingTowards);
+    return ((((AltitudeMap[next]>=AltitudeMap[bankLast]) ||
+              (AltitudeMap[next]>=AltitudeMap[goingTowards])) &&
+             (!nextOnBank) && (!towardsOnBank)) ||
+            (CheckIfLakeTile(next)>=(AltitudeMap[goingTowards]-1)) ||
+            (CheckIfLakeTile(next)>=(AltitudeMap[bankLast]-1)));
+}
+
+//Turns the river around its right bank (rightTurn) or its left bank, towards "goingTowards"
+//Returns 0 if the segment went on, or the state of the segment to start if the river goes up there : 2=cascade, 3=waterfall
+int32 AC_MapGenerator::TurnRiverSegment(RiverSegment *actualSeg, int32 goingTowards, bool rightTurn)
+{
+    int32 pivot = rightTurn ? actualSeg->RightBank.Last() : actualSeg->LeftBank.Last();
+    if ((AltitudeMap[pivot] > actualSeg->segAltitude) &&
+        (AltitudeMap[goingTowards] > actualSeg->segAltitude)) {
+        if (((AltitudeMap[pivot]-actualSeg->segAltitude)==2) &&
+            ((AltitudeMap[goingTowards]-actualSeg->segAltitude)==2)) {
+            return 3;
+        }
+        return 2;
+    }
+    if (rightTurn) {
+        PushRiverBanks(actualSeg, goingTowards, pivot, actualSeg->dir.Last()-1);
+    }
+    else {
+        PushRiverBanks(actualSeg, pivot, goingTowards, actualSeg->dir.Last()+1);
+    }
+    return 0;
+}
+
+//Builds the segment of "frame" until it ends or has to start another segment
+//childResult is the result of the last segment started by this one, if any
+//Returns 0 if the segment failed (and got removed), 1 if it ended, 2 if "started" has to be built before coming back to this segment
+int32 AC_MapGenerator::GrowRiverSegment(RiverBuildFrame &frame, bool childResult, RiverBuildFrame &started)
+{
+    RiverSegment *actualSeg = frame.segment;
+    switch (frame.resumeAt) {
+        case 1://Back from the cascade/waterfall segment : this segment is over
+            return 1;
+        case 2://Back from the right fork segment : building the left one
+            frame.rightForkOk=childResult;
+            frame.resumeAt=3;
+            started=BeginRiverSegment(frame.forkLeft, frame.forkRight, frame.forkDir, 1, false, 0);
+            return 2;
+        case 3://Back from both fork segments
+            frame.resumeAt=0;
+            if (childResult && frame.rightForkOk) {
+                return 1;
+            }
+            else if (childResult || frame.rightForkOk) {
+                RemoveLastRiverSegment();//Failed fork (often because right branch took too much space)
+            }
+            if (RiverRandom.RandRange(1, 100) > 87) {
+                actualSeg->segEnd=0;
+                return 1;
             }
-            switch (nextTurn) {
-                case 1://Turning right
-                    if ((AltitudeMap[actualSeg->RightBank.Last()] > actualSeg->segAltitude) &&
-                        (AltitudeMap[goingTowards] > actualSeg->segAltitude)) {
-                        if (((AltitudeMap[actualSeg->RightBank.Last()]-actualSeg->segAltitude)==2) &&
-                            ((AltitudeMap[goingTowards]-actualSeg->segAltitude)==2)) {
-                            actualSeg->segEnd=3;
-                            BuildRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 3, false, 0);
-                        }
-                        else {
-                            actualSeg->segEnd=2;
-                            BuildRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 2, false, 0);
-                        }
-                        anotherLoop=false;
-                    }
-                    else {
-                        int32 temp;
-                        actualSeg->LeftBank.Push(goingTowards);
-                        temp=actualSeg->RightBank.Last();
-                        actualSeg->RightBank.Push(temp);
-                        temp=actualSeg->dir.Last()-1;
-                        actualSeg->dir.Push(temp);
-                    }
-                    break;
-                case 2://Turning left
-                    if ((AltitudeMap[actualSeg->LeftBank.Last()] > actualSeg->segAltitude) &&
-                        (AltitudeMap[goingTowards] > actualSeg->segAltitude)) {
-                        if (((AltitudeMap[actualSeg->LeftBank.Last()]-actualSeg->segAltitude)==2) &&
-                            ((AltitudeMap[goingTowards]-actualSeg->segAltitude)==2)) {
-                            actualSeg->segEnd=3;
-                            BuildRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, 3, false, 0);
-                        }
-                        else {
-                            actualSeg->segEnd=2;
-                            BuildRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, 2, false, 0);
-                        }
-                        anotherLoop=false;
+            break;
+        default:
+            break;
+    }
+    
+    while (true) {
+        int32 goingTowards=getNeighbor(actualSeg->LeftBank.Last(), actualSeg->dir.Last()+1);
+        if (goingTowards==-1) {
+            actualSeg->segEnd=0;//Out of map
+            return 1;
+        }
+        
+        //REDUNDANCY CHECKS :D
+        if ((CheckifAlreadyInLeftBank(goingTowards) && CheckifAlreadyInRightBank(frame.startLeft)) ||
+            (CheckifAlreadyInRightBank(goingTowards) && CheckifAlreadyInLeftBank(frame.startRight))) {
+            RemoveLastRiverSegment();
+            return 0; //Case where a river can't start where it was supposed to because of another river having already taken its place
+        }
+        
+        int32 goingToLeft=getNeighbor(actualSeg->LeftBank.Last(), actualSeg->dir.Last()+2);
+        int32 goingToRight=getNeighbor(actualSeg->RightBank.Last(), actualSeg->dir.Last()+1);
+        int32 nextTurn=0;//1=right, 2=left, 3=random, 4=end, 5=hit a lake
+        if (CheckIfLakeTile(goingTowards) != -1) {
+            nextTurn=5;
+        }
+        else if (goingToLeft == -1) {
+            nextTurn = CheckIfRiverCanTurn(goingToRight, actualSeg->RightBank.Last(), goingTowards, true) ? 1 : 4;
+        }
+        else if (goingToRight == -1) {
+            nextTurn = CheckIfRiverCanTurn(goingToLeft, actualSeg->LeftBank.Last(), goingTowards, false) ? 2 : 4;
+        }
+        else if (CheckIfRiverCanTurn(goingToRight, actualSeg->RightBank.Last(), goingTowards, true)) {
+            nextTurn = CheckIfRiverCanTurn(goingToLeft, actualSeg->LeftBank.Last(), goingTowards, false) ? 3 : 1;
+        }
+        else {
+            nextTurn = CheckIfRiverCanTurn(goingToLeft, actualSeg->LeftBank.Last(), goingTowards, false) ? 2 : 4;
+        }
+        
+        if (nextTurn==3) {
+            if ((AltitudeMap[actualSeg->RightBank.Last()] == AltitudeMap[goingTowards]) &&
+                (AltitudeMap[actualSeg->LeftBank.Last()] == AltitudeMap[goingTowards]) &&
+                (RiverRandom.RandRange(0, 9) == 0)) {//Forking only allowed when all 3 main tiles at same height, with given probability
+                actualSeg->segEnd=1;
+                frame.forkLeft=actualSeg->LeftBank.Last();
+                frame.forkRight=goingTowards;
+                frame.forkDir=actualSeg->dir.Last()+1;
+                frame.resumeAt=2;
+                started=BeginRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 1, false, 0);//Building right fork seg
+                return 2;
+            }
+            nextTurn = (RiverRandom.RandRange(0, 1) == 1) ? 1 : 2;
+        }
+        
+        switch (nextTurn) {
+            case 1://Turning right
+            case 2://Turning left
+            {
+                int32 climb=TurnRiverSegment(actualSeg, goingTowards, nextTurn==1);
+                if (climb != 0) {
+                    actualSeg->segEnd=climb;
+                    frame.resumeAt=1;
+                    if (nextTurn==1) {
+                        started=BeginRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, climb, false, 0);
                     }
                     else {
-                        int32 temp;
-                        actualSeg->RightBank.Push(goingTowards);
-                        temp=actualSeg->LeftBank.Last();
-                        actualSeg->LeftBank.Push(temp);
-                        temp=actualSeg->dir.Last()+1;
-                        actualSeg->dir.Push(temp);
-                    }
-                    break;
-                case 3:
-                    if ((AltitudeMap[actualSeg->RightBank.Last()] == AltitudeMap[goingTowards]) &&
-                        (AltitudeMap[actualSeg->LeftBank.Last()] == AltitudeMap[goingTowards]) &&
-                        (randomstream.RandRange(0, 9) == 0)) {//Forking only allowed when all 3 main tiles at same height, with given probability
-                        actualSeg->segEnd=1;
-                        bool leftok, rightok;
-                        rightok=BuildRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 1, false, 0);//Building right fork seg
-                        leftok=BuildRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, 1, false, 0);//Building left fork seg
-                        if (leftok && rightok) {
-                            anotherLoop=false;
-                        }
-                        else if (leftok || rightok) {
-                            Rivers.RemoveAt(Rivers.Num()-1);//Failed fork (often because right branch took too much space)
-                        }
-                    }
-                    else if (randomstream.RandRange(0, 1) == 1) {//Turning right
-                        if ((AltitudeMap[actualSeg->RightBank.Last()] > actualSeg->segAltitude) &&
-                            (AltitudeMap[goingTowards] > actualSeg->segAltitude)) {
-                            if (((AltitudeMap[actualSeg->RightBank.Last()]-actualSeg->segAltitude)==2) &&
-                                ((AltitudeMap[goingTowards]-actualSeg->segAltitude)==2)) {
-                                actualSeg->segEnd=3;
-                                BuildRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 3, false, 0);
-                            }
-                            else {
-                                actualSeg->segEnd=2;
-                                BuildRiverSegment(goingTowards, actualSeg->RightBank.Last(), actualSeg->dir.Last()-1, 2, false, 0);
-                            }
-                            anotherLoop=false;
-                        }
-                        else {
-                            int32 temp;
-                            actualSeg->LeftBank.Push(goingTowards);
-                            temp=actualSeg->RightBank.Last();
-                            actualSeg->RightBank.Push(temp);
-                            temp=actualSeg->dir.Last()-1;
-                            actualSeg->dir.Push(temp);
-                        }
-                    }
-                    else {//Turning left
-                        if ((AltitudeMap[actualSeg->LeftBank.Last()] > actualSeg->segAltitude) &&
-                            (AltitudeMap[goingTowards] > actualSeg->segAltitude)) {
-                            if (((AltitudeMap[actualSeg->LeftBank.Last()]-actualSeg->segAltitude)==2) &&
-                                ((AltitudeMap[goingTowards]-actualSeg->segAltitude)==2)) {
-                                actualSeg->segEnd=3;
-                                BuildRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, 3, false, 0);
-                            }
-                            else {
-                                actualSeg->segEnd=2;
-                                BuildRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, 2, false, 0);
-                            }
-                            anotherLoop=false;
-                        }
-                        else {
-                            int32 temp;
-                            actualSeg->RightBank.Push(goingTowards);
-                            temp=actualSeg->LeftBank.Last();
-                            actualSeg->LeftBank.Push(temp);
-                            temp=actualSeg->dir.Last()+1;
-                            actualSeg->dir.Push(temp);
-                        }
+                        started=BeginRiverSegment(actualSeg->LeftBank.Last(), goingTowards, actualSeg->dir.Last()+1, climb, false, 0);
                     }
-                    break;
-                case 4:
-                    anotherLoop=false;
-                    actualSeg->segEnd=0;
-                    break;
-                case 5:
-                    anotherLoop=false;
-                    actualSeg->segEnd=4;/*
-                    for (int32 i=0; i<Lakes.Num(); i++) {
-                        if (Lakes[i]->tiles.Contains(goingTowards)) {//Finding which Lake we connected
-                            TArray<int32> EligibleLakeLeftStart;
-                            TArray<int32> EligibleLakeRightStart;
-                            TArray<int32> EligibleLakeDir;
-                            for (int32 j=0; j<Lakes[i]->tiles.Num(); j++) {
-                                for (int32 k=1; k<7; k++) {
-                                    int32 current=getNeighbor(getX(Lakes[i]->tiles[j]), getY(Lakes[i]->tiles[j]), k);
-                                    if (current!=-1) {
-                                        if (!EligibleLakeLeftStart.Contains(current)) {
-                                            for (int32 l=1; l<7; l++) {
-                                                if (CheckIfEligibleRiverLakeStart(current, l, i)) {
-                                                    EligibleLakeLeftStart.Push(current);
-                                                    EligibleLakeRightStart.Push(getNeighbor(getX(current), getY(current), l));
-                                                    EligibleLakeDir.Push(l);
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                            FString NewString = FString::FromInt(EligibleLakeLeftStart.Num());
-                            
-                            for (int32 j=0; j<2; j++) {//3 attempts to place a river; might result in 0-3 new segments
-                                if ((EligibleLakeLeftStart.Num() > 0) && (randomstream.RandRange(0,EligibleLakeLeftStart.Num())) > 0) {
-                                    int32 selected = randomstream.RandRange(1, EligibleLakeLeftStart.Num()) - 1;
-                                    BuildRiverSegment(EligibleLakeLeftStart[selected], EligibleLakeRightStart[selected], EligibleLakeDir[selected], 0, true, actualSeg->segAltitude);
-                                    EligibleLakeLeftStart.RemoveAt(selected);
-                                    EligibleLakeRightStart.RemoveAt(selected);
-                                    EligibleLakeDir.RemoveAt(selected);
-                                }
-                            }
-                        }
-                    }*/
-                    break;
-                  
-                default:
-                    anotherLoop=false;
-                    actualSeg->segEnd=0;
-                    break;
-            }
-            if (anotherLoop) {
-                if (randomstream.RandRange(1, 100) > 87) {
-                    anotherLoop=false;
-                    actualSeg->segEnd=0;
+                    return 2;
                 }
+                break;
             }
+            case 5:
+                actualSeg->segEnd=4;//Rivers don't start again from the other side of lakes yet
+                return 1;
+            default:
+                actualSeg->segEnd=0;
+                return 1;
+        }
+        if (RiverRandom.RandRange(1, 100) > 87) {
+            actualSeg->segEnd=0;
+            return 1;
         }
     }
-    return true;
 }
 
 //Checks if, given a starting hex "i" and a direction "dir", this side of a coastal hex could start a river; requires both starting hexes to be same height. Will also return false if hex is not a coastal hex or if hex is water. Note that this only checks if the tile is on the left bank, so there will be only 1 pairing left/right bank.
@@ -892,9 +1260,9 @@ bool AC_MapGenerator::CheckIfEligibleRiverStart(int32 i, int32 dir)
     int32 topdir=dir+1;
     int32 botdir=dir-1;
     
-    int32 current=getNeighbor(getX(i), getY(i), dir);
-    int32 topcurrent=getNeighbor(getX(i), getY(i), topdir);
-    int32 botcurrent=getNeighbor(getX(i), getY(i), botdir);
+    int32 current=getNeighbor(i, dir);
+    int32 topcurrent=getNeighbor(i, topdir);
+    int32 botcurrent=getNeighbor(i, botdir);
     
     if ((current==-1) || (topcurrent==-1) || (botcurrent==-1)) {//This is probably redundant, but better be safe
         return false;//side of map -> nope
@@ -950,9 +1318,9 @@ bool AC_MapGenerator::CheckIfEligibleRiverLakeStart(int32 i, int32 dir, int32 la
     int32 topdir=dir+1;
     int32 botdir=dir-1;
     
-    int32 current=getNeighbor(getX(i), getY(i), dir);
-    int32 topcurrent=getNeighbor(getX(i), getY(i), topdir);
-    int32 botcurrent=getNeighbor(getX(i), getY(i), botdir);
+    int32 current=getNeighbor(i, dir);
+    int32 topcurrent=getNeighbor(i, topdir);
+    int32 botcurrent=getNeighbor(i, botdir);
     
     if ((current==-1) || (topcurrent==-1) || (botcurrent==-1)) {//This is probably redundant, but better be safe
         return false;//side of map -> nope
@@ -1008,1129 +1376,286 @@ bool AC_MapGenerator::CheckIfEligibleRiverLakeStart(int32 i, int32 dir, int32 la
 //Fills up the freshWaterTiles array; 0 is no fresh water, 1 is next to lake, 2 is next to river; river overrides lake. Needs rivers and lakes to be placed so need to be placed after BuildRivers and before GenerateDeserts
 void AC_MapGenerator::CheckFreshWater()
 {
-    freshWater.SetNum(mapsizex*mapsizey);
-    for (int32 i=0; i<(mapsizex*mapsizey); i++) {
+    if (IsRefusedDuringGeneration(TEXT("CheckFreshWater"))) {
+        return;
+    }
+    NeighborTable->ApplyStencil(TerrainType, ETerrain::VE_Void, freshWater, [this](int32 i, const ETerrain* neighbors) {
         int32 freshWaterType=0;
         if ((TerrainType[i]!=ETerrain::VE_Coast) || (TerrainType[i]!=ETerrain::VE_Lake) || (TerrainType[i]!=ETerrain::VE_Ocean)) {//if tile is not water, then
-            for (int32 j=1; j<7; j++) {
-                int32 current = getNeighbor(getX(i), getY(i), j);
-                if (current != -1) {
-                    if (TerrainType[current] == ETerrain::VE_Lake) {//check if it's next to a lake
-                        freshWaterType=1;
-                    }
-                }
+            int32 NumberOfLakeNeighbors=0;
+            for (int32 j=0; j<6; j++) {
+                NumberOfLakeNeighbors+=(neighbors[j] == ETerrain::VE_Lake);//check if it's next to a lake
             }
-            if ((RiverOn1[i]==1) || (RiverOn2[i]==1) || (RiverOn3[i]==1) || (RiverOn4[i]==1) || (RiverOn5[i]==1) || (RiverOn6[i]==1)) {//or to a river
+            freshWaterType=(NumberOfLakeNeighbors != 0) ? 1 : 0;
+            if (RiverEdges[i] != 0) {//or to a river
                 freshWaterType=2;
             }
         }
-        freshWater[i]=freshWaterType;
-    }
+        return freshWaterType;
+    });
 }
 
 //Internal function; returns false if tile is not next to a water tile or a river
 bool AC_MapGenerator::CheckIfTileIsNextToWater(int32 index)
 {
     for (int32 i=1; i<7; i++) {
-        int32 current = getNeighbor(getX(index), getY(index), i);
+        int32 current = getNeighbor(index, i);
         if (current != -1) {
-            if ((TerrainType[i]==ETerrain::VE_Coast) || (TerrainType[i]==ETerrain::VE_Lake) || (TerrainType[i]==ETerrain::VE_Ocean)) {
+            if ((TerrainType[current]==ETerrain::VE_Coast) || (TerrainType[current]==ETerrain::VE_Lake) || (TerrainType[current]==ETerrain::VE_Ocean)) {
                 return true;
             }
         }
     }
-    if ((RiverOn1[index]==1) || (RiverOn2[index]==1) || (RiverOn3[index]==1) || (RiverOn4[index]==1) || (RiverOn5[index]==1) || (RiverOn6[index]==1)) {
+    if (RiverEdges[index] != 0) {
         return true;
     }
     return false;
 }
 
-//Generates deserts on the map
-//Uses TerrainType info and river positioning to place desert "seeds" far from water and not on snow, so needs to be placed after BuildRivers bet before SetTransitions
-void AC_MapGenerator::GenerateDeserts()
+//Builds every distance field (see EMapDistance) with one multi-source breadth first search each; water fields don't change with deserts, so this can run right after the rivers
+void AC_MapGenerator::BuildDistanceFields()
 {
-    TArray<int32> potentialSeeds;
-    for (int32 i=0; i<LandTiles.Num(); i++) {
-        if ((CheckIfTileIsNextToWater(LandTiles[i])) && (TerrainType[LandTiles[i]] != ETerrain::VE_Snow)) {//Tile is not next to water and is not snow
-            bool neighborsHaveNoWater=true;
-            for (int32 j=1; j<7; j++) {
-                int32 current= getNeighbor(getX(LandTiles[i]), getY(LandTiles[i]), j);
-                if (current != -1) {
-                    if (freshWater[current] != 0) {//Tile's neighbors are not next to water either
-                        neighborsHaveNoWater=false;
-                        break;
-                    }
-                }
-            }
-            if (neighborsHaveNoWater) {
-                potentialSeeds.Push(LandTiles[i]);
-            }
-        }
+    if (IsRefusedDuringGeneration(TEXT("BuildDistanceFields"))) {
+        return;
     }
-    
-    for (int32 i=potentialSeeds.Num()-1; i>=0; i--) {//Removing approx 3/4 of desert seeds
-        if (randomstream.RandRange(0, 3) != 0) {
-            potentialSeeds.RemoveAt(i);
+    ParallelFor(NumberOfMapDistances, [this](int32 field) {
+        switch ((EMapDistance)field) {
+            case EMapDistance::VE_Water:
+                NeighborTable->ComputeDistances([this](int32 i) {
+                    return (TerrainType[i]==ETerrain::VE_Coast) || (TerrainType[i]==ETerrain::VE_Ocean) || (TerrainType[i]==ETerrain::VE_Lake);
+                }, DistanceFields[field]);
+                break;
+            case EMapDistance::VE_Ocean:
+                NeighborTable->ComputeDistances([this](int32 i) {
+                    return (TerrainType[i]==ETerrain::VE_Coast) || (TerrainType[i]==ETerrain::VE_Ocean);
+                }, DistanceFields[field]);
+                break;
+            case EMapDistance::VE_Lake:
+                NeighborTable->ComputeDistances([this](int32 i) {
+                    return TerrainType[i]==ETerrain::VE_Lake;
+                }, DistanceFields[field]);
+                break;
+            case EMapDistance::VE_River:
+                NeighborTable->ComputeDistances([this](int32 i) {
+                    return RiverEdges[i] != 0;
+                }, DistanceFields[field]);
+                break;
+            case EMapDistance::VE_Land:
+                NeighborTable->ComputeDistances([this](int32 i) {
+                    return (TerrainType[i]!=ETerrain::VE_Coast) && (TerrainType[i]!=ETerrain::VE_Ocean) && (TerrainType[i]!=ETerrain::VE_Lake);
+                }, DistanceFields[field]);
+                break;
+            default:
+                break;
         }
-    }
-    
-    int32 ChainLength = 6;
-    TArray<int32> Chains;
-    Chains.SetNum(potentialSeeds.Num());
-    int32 ChainActual, gridx, gridy;
-    int32 nextDir;
+    });
+}
 
-    //Markov chains similar to the ones used to generate altitude map; starts somewhere and then moves randomly around for a randomized length, transforming every land tile to desert (except snow)
-    for (int32 i=0; i<potentialSeeds.Num(); i++) {
-        Chains[i]=randomstream.RandRange(1, ChainLength*2);
-        
-        ChainActual=potentialSeeds[i];
-        gridx=getX(ChainActual);
-        gridy=getY(ChainActual);
-        
-        for (int32 j=0; j<Chains[i]; j++) {
-            if ((TerrainType[ChainActual] != ETerrain::VE_Coast) && (TerrainType[ChainActual] != ETerrain::VE_Snow)) { //If terrain is not water or snow, set to desert
-                TerrainType[ChainActual]=ETerrain::VE_Desert;
-            }
-            nextDir=randomstream.RandRange(1, 6);
-            while (getNeighbor(gridx, gridy, nextDir) == -1) {//Handling out-of-map cases
-                nextDir=randomstream.RandRange(1, 6);
-            }
-            ChainActual=getNeighbor(gridx, gridy, nextDir);
-            gridx=getX(ChainActual);
-            gridy=getY(ChainActual);
-        }
-    }
+int32 AC_MapGenerator::GetDistance(EMapDistance field, int32 index)
+{
+    const TArray<int32>& distances=DistanceFields[(int32)field];
+    return distances.IsValidIndex(index) ? distances[index] : -1;
 }
 
+//Generates deserts on the map, as set by ClimateMode
+//Uses TerrainType info and river positioning, so needs to be placed after BuildRivers (and BuildDistanceFields) but before SetTransitions
+void AC_MapGenerator::GenerateDeserts()
+{
+    if (IsRefusedDuringGeneration(TEXT("GenerateDeserts"))) {
+        return;
+    }
+    if (ClimateMode==EClimateMode::VE_Moisture) {
+        GenerateClimateDeserts();
+    }
+    else {
+        GenerateSeededDeserts();
+    }
+}
 
-//Takes in a altitude map and determines where ramps should be placed on every hex in the map, in the form of 2 1D arrays. See .h for hex ramp types, rotations are multiples of +60 degrees (0,1,2,3,4,5)
-//Uses unreduced AltitudeMap and TerrainType arrays (to check if terrain is water), so has to be placed between GenerateTerrainType and ReduceLandAltitude
-void AC_MapGenerator::GetHexTypesAndRotations()
+//Places desert "seeds" far from water and not on snow
+void AC_MapGenerator::GenerateSeededDeserts()
 {
-    int32 mapsize = mapsizex*mapsizey;
-    int32 x, y;
-    
-    int32 currentRotation, additionalCoastRotation;
-    int32 arrayPosNeighbor;
-    
-    int32 temp;
-    int32 Ramps[6];
-    int32 CliffCoast[6];
-    bool Ocean[6];
-    
-    RampType.SetNum(mapsize);
-    CoastType.SetNum(mapsize);
-    OceanCoastType.SetNum(mapsize);
-    RampRotation.SetNum(mapsize);
-    CoastRotation.SetNum(mapsize);
-    
-    //Determining the type and rotation of each tile from the Ramps array
-    for (int32 i=0; i<mapsize; i++) {
- 
-        //Determining configuration of neighbors for position of ramps/coasts
-        x=getX(i);
-        y=getY(i);
-        for (int32 j=0; j<6; j++) {
-            CliffCoast[j]=0;
-            Ocean[j]=false;
-            arrayPosNeighbor = getNeighbor(x, y, j+1);
-            if (arrayPosNeighbor == -1) {//Dealing with out-of-map cases
-                Ramps[j]=0;
-            }
-            else if ((AltitudeMap[arrayPosNeighbor]-AltitudeMap[i]) == 1) {
-                Ramps[j]=1;
-            }
-            else if ((TerrainType[i] == ETerrain::VE_Coast) || (TerrainType[i] == ETerrain::VE_Lake)) {//For cases of coasts next to cliffs
-                if ((AltitudeMap[arrayPosNeighbor]-AltitudeMap[i]) > 1) {
-                    Ramps[j]=1;
-                    CliffCoast[j]=1;
-                }
-                else {
-                    Ramps[j]=0;
-                    Ocean[j]=CheckIfOcean(arrayPosNeighbor);//Checks if neighbor is an ocean hex
-                }
-            }
-            else {
-                Ramps[j]=0;
-            }
-        }
- 
-        currentRotation=0;
-        additionalCoastRotation=0;
-        OceanCoastType[i]=0;//By default, all ocean coast types are 0
-        
-        //Checking 000000 case
-        if (Ramps[0]==0 && Ramps[1]==0 && Ramps[2]==0 && Ramps[3]==0 && Ramps[4]==0 && Ramps[5]==0) {
-            RampType[i]=0;
-            CoastType[i]=0;
-            currentRotation=randomstream.RandRange(0, 5);
+    FMemMark Mark(FMemStack::Get());
+    const TArray<int32>& toWater=GetDistanceField(EMapDistance::VE_Water);
+    const TArray<int32>& toLake=GetDistanceField(EMapDistance::VE_Lake);
+    const TArray<int32>& toRiver=GetDistanceField(EMapDistance::VE_River);
+    TArray<int32, TMemStackAllocator<>> potentialSeeds;
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        int32 tile=LandTiles[i];
+        bool isNextToWater=(toWater[tile]==1) || (toRiver[tile]==0);
+        //Tile's neighbors are not next to water either : no lake within 2 tiles, no river on the sides of the neighbors
+        bool neighborsHaveNoWater=((toLake[tile]==-1) || (toLake[tile]>2)) && ((toRiver[tile]==-1) || (toRiver[tile]>1));
+        if (!isNextToWater && (TerrainType[tile] != ETerrain::VE_Snow) && neighborsHaveNoWater) {//Tile is not next to water and is not snow
+            potentialSeeds.Push(tile);
         }
-
-        //Checking 111111 case
-        else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==1 && Ramps[3]==1 && Ramps[4]==1 && Ramps[5]==1) {
-            RampType[i]=13;
-            CoastType[i]=13;
-            
-            //Checking cliff profile; no possible ocean profile
-            if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==0) {
-                currentRotation=randomstream.RandRange(0, 5);
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==1) {
-                CoastType[i]=12;
-                if (CliffCoast[0]==1) {
-                    additionalCoastRotation=1;
-                }
-                else if (CliffCoast[1]==1) {
-                    additionalCoastRotation=2;
-                }
-                else if (CliffCoast[2]==1) {
-                    additionalCoastRotation=3;
-                }
-                else if (CliffCoast[3]==1) {
-                    additionalCoastRotation=4;
-                }
-                else if (CliffCoast[4]==1) {
-                    additionalCoastRotation=5;
-                }
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==2) {
-                if (CliffCoast[0]==1) {
-                    if (CliffCoast[1]==1) {
-                        CoastType[i]=9;
-                        additionalCoastRotation=2;
-                    }
-                    else if (CliffCoast[2]==1) {
-                        CoastType[i]=10;
-                        additionalCoastRotation=3;
-                    }
-                    else if (CliffCoast[3]==1) {
-                        CoastType[i]=11;
-                        additionalCoastRotation=1;
-                    }
-                    else if (CliffCoast[4]==1) {
-                        CoastType[i]=10;
-                        additionalCoastRotation=1;
-                    }
-                    else {
-                        CoastType[i]=9;
-                        additionalCoastRotation=1;
-                    }
-                }
-                else if (CliffCoast[1]==1) {
-                    if (CliffCoast[2]==1) {
-                        CoastType[i]=9;
-                        additionalCoastRotation=3;
-                    }
-                    else if (CliffCoast[3]==1) {
-                        CoastType[i]=10;
-                        additionalCoastRotation=4;
-                    }
-                    else if (CliffCoast[4]==1) {
-                        CoastType[i]=11;
-                        additionalCoastRotation=2;
-                    }
-                    else {
-                        CoastType[i]=10;
-                        additionalCoastRotation=2;
-                    }
-                }
-                else if (CliffCoast[2]==1) {
-                    if (CliffCoast[3]==1) {
-                        CoastType[i]=9;
-                        additionalCoastRotation=4;
-                    }
-                    else if (CliffCoast[4]==1) {
-                        CoastType[i]=10;
-                        additionalCoastRotation=5;
-                    }
-                    else {
-                        CoastType[i]=11;
-                    }
-                }
-                else if (CliffCoast[3]==1) {
-                    if (CliffCoast[4]==1) {
-                        CoastType[i]=9;
-                        additionalCoastRotation=5;
-                    }
-                    else {
-                        CoastType[i]=10;
-                    }
-                }
-                else {
-                    CoastType[i]=9;
-                }
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==3) {
-                if (CliffCoast[0]==0) {
-                    if (CliffCoast[1]==0) {
-                        if (CliffCoast[2]==0) {
-                            CoastType[i]=5;
-                        }
-                        else if (CliffCoast[3]==0) {
-                            CoastType[i]=6;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            CoastType[i]=7;
-                        }
-                        else {
-                            CoastType[i]=5;
-                            additionalCoastRotation=5;
-                        }
-                    }
-                    else if (CliffCoast[2]==0) {
-                        if (CliffCoast[3]==0) {
-                            CoastType[i]=7;
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            CoastType[i]=8;
-                        }
-                        else {
-                            CoastType[i]=6;
-                            additionalCoastRotation=5;
-                        }
-                    }
-                    else if (CliffCoast[3]==0) {
-                        if (CliffCoast[4]==0) {
-                            CoastType[i]=6;
-                            additionalCoastRotation=3;
-                        }
-                        else {
-                            CoastType[i]=7;
-                            additionalCoastRotation=5;
-                        }
-                    }
-                    else {
-                        CoastType[i]=5;
-                        additionalCoastRotation=4;
-                    }
-                }
-                else if (CliffCoast[1]==0) {
-                    if (CliffCoast[2]==0) {
-                        additionalCoastRotation=1;
-                        if (CliffCoast[3]==0) {
-                            CoastType[i]=5;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            CoastType[i]=6;
-                        }
-                        else {
-                            CoastType[i]=7;
-                        }
-                    }
-                    else if (CliffCoast[3]==0) {
-                        if (CliffCoast[4]==0) {
-                            CoastType[i]=7;
-                            additionalCoastRotation=3;
-                        }
-                        else {
-                            CoastType[i]=8;
-                            additionalCoastRotation=1;
-                        }
-                    }
-                    else {
-                        CoastType[i]=6;
-                        additionalCoastRotation=4;
-                    }
-                }
-                else if (CliffCoast[2]==0) {
-                    if (CliffCoast[3]==0) {
-                        additionalCoastRotation=2;
-                        if (CliffCoast[4]==0) {
-                            CoastType[i]=5;
-                        }
-                        else {
-                            CoastType[i]=6;
-                        }
-                    }
-                    else {
-                        CoastType[i]=7;
-                        additionalCoastRotation=4;
-                    }
-                }
-                else {
-                    CoastType[i]=5;
-                    additionalCoastRotation=3;
-                }
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==4) {
-                if (CliffCoast[0]==0) {
-                    if (CliffCoast[1]==0) {
-                        CoastType[i]=2;
-                    }
-                    else if (CliffCoast[2]==0) {
-                        CoastType[i]=3;
-                    }
-                    else if (CliffCoast[3]==0) {
-                        CoastType[i]=4;
-                    }
-                    else if (CliffCoast[4]==0) {
-                        CoastType[i]=3;
-                        additionalCoastRotation=4;
-                    }
-                    else {
-                        CoastType[i]=2;
-                        additionalCoastRotation=5;
-                    }
-                }
-                else if (CliffCoast[1]==0) {
-                    if (CliffCoast[2]==0) {
-                        CoastType[i]=2;
-                        additionalCoastRotation=1;
-                    }
-                    else if (CliffCoast[3]==0) {
-                        CoastType[i]=3;
-                        additionalCoastRotation=1;
-                    }
-                    else if (CliffCoast[4]==0) {
-                        CoastType[i]=4;
-                        additionalCoastRotation=1;
-                    }
-                    else {
-                        CoastType[i]=3;
-                        additionalCoastRotation=5;
-                    }
-                }
-                else if (CliffCoast[2]==0) {
-                    additionalCoastRotation=2;
-                    if (CliffCoast[3]==0) {
-                        CoastType[i]=2;
-                    }
-                    else if (CliffCoast[4]==0) {
-                        CoastType[i]=3;
-                    }
-                    else {
-                        CoastType[i]=4;
-                    }
-                }
-                else if (CliffCoast[3]==0) {
-                    additionalCoastRotation=3;
-                    if (CliffCoast[4]==0) {
-                        CoastType[i]=2;
-                    }
-                    else {
-                        CoastType[i]=3;
-                    }
-                }
-                else {
-                    CoastType[i]=2;
-                    additionalCoastRotation=4;
-                }
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==5) {
-                CoastType[i]=1;
-                if (CliffCoast[1]==0) {
-                    additionalCoastRotation=1;
-                }
-                else if (CliffCoast[2]==0) {
-                    additionalCoastRotation=2;
-                }
-                else if (CliffCoast[3]==0) {
-                    additionalCoastRotation=3;
-                }
-                else if (CliffCoast[4]==0) {
-                    additionalCoastRotation=4;
-                }
-                else if (CliffCoast[5]==0) {
-                    additionalCoastRotation=5;
-                }
-            }
-            else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4]+CliffCoast[5])==6) {
-                CoastType[i]=0;
-            }
-        }
-        
-        //Must account for possible rotations in all other cases
-        else {
-            for (int32 j=0; j<6; j++) {
-                
-                //Checking 100000 case
-                if (Ramps[0]==1 && Ramps[1]==0 && Ramps[2]==0 && Ramps[3]==0 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=1;
-                    CoastType[i]=1;
-                    
-                    //Checking cliff profile
-                    if (CliffCoast[0]==1) {
-                        CoastType[i]=0;
-                    }
-                    
-                    //Checking ocean profile; can be done separately only in this specific case
-                    if ((Ocean[2]==true) && (Ocean[3]==false) && (Ocean[4]==false)) {
-                        OceanCoastType[i]=1;
-                    }
-                    if ((Ocean[2]==false) && (Ocean[3]==true) && (Ocean[4]==false)) {
-                        OceanCoastType[i]=2;
-                    }
-                    if ((Ocean[2]==false) && (Ocean[3]==false) && (Ocean[4]==true)) {
-                        OceanCoastType[i]=3;
-                    }
-                    if ((Ocean[2]==true) && (Ocean[3]==true) && (Ocean[4]==false)) {
-                        OceanCoastType[i]=4;
-                    }
-                    if ((Ocean[2]==true) && (Ocean[3]==false) && (Ocean[4]==true)) {
-                        OceanCoastType[i]=5;
-                    }
-                    if ((Ocean[2]==false) && (Ocean[3]==true) && (Ocean[4]==true)) {
-                        OceanCoastType[i]=6;
-                    }
-                    if ((Ocean[2]==true) && (Ocean[3]==true) && (Ocean[4]==true)) {
-                        OceanCoastType[i]=7;
-                    }
-                    break;
-                }
-                
-                //Checking 110000 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==0 && Ramps[3]==0 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=2;
-                    CoastType[i]=2;
-                    
-                    //Checking cliff profile
-                    if ((CliffCoast[0]+CliffCoast[1])==1) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            //Checking ocean profile
-                            if ((Ocean[3]==true) && (Ocean[4]==false)) {
-                                OceanCoastType[i]=1;
-                            }
-                            if ((Ocean[3]==false) && (Ocean[4]==true)) {
-                                OceanCoastType[i]=2;
-                            }
-                            if ((Ocean[3]==true) && (Ocean[4]==true)) {
-                                OceanCoastType[i]=4;
-                            }
-                        }
-                        else {
-                            //Checking ocean profile
-                            if ((Ocean[3]==true) && (Ocean[4]==false)) {
-                                OceanCoastType[i]=2;
-                            }
-                            if ((Ocean[3]==false) && (Ocean[4]==true)) {
-                                OceanCoastType[i]=3;
-                            }
-                            if ((Ocean[3]==true) && (Ocean[4]==true)) {
-                                OceanCoastType[i]=6;
-                            }
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1])==2) {
-                        CoastType[i]=0;
-                        //Checking ocean profile
-                        if ((Ocean[3]==true) && (Ocean[4]==false)) {
-                            OceanCoastType[i]=2;
-                        }
-                        if ((Ocean[3]==false) && (Ocean[4]==true)) {
-                            OceanCoastType[i]=3;
-                        }
-                        if ((Ocean[3]==true) && (Ocean[4]==true)) {
-                            OceanCoastType[i]=6;
-                        }
-                    }
-                    else {
-                        //Checking ocean profile
-                        if ((Ocean[3]==true) && (Ocean[4]==false)) {
-                            OceanCoastType[i]=2;
-                        }
-                        if ((Ocean[3]==false) && (Ocean[4]==true)) {
-                            OceanCoastType[i]=3;
-                        }
-                        if ((Ocean[3]==true) && (Ocean[4]==true)) {
-                            OceanCoastType[i]=6;
-                        }
-                    }
-                    break;
-                }
-                
-                //Checking 101000 case
-                else if (Ramps[0]==1 && Ramps[1]==0 && Ramps[2]==1 && Ramps[3]==0 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=3;
-                    CoastType[i]=3;
-                    
-                    //Checking cliff profile
-                    if ((CliffCoast[0]+CliffCoast[2])==1) {
-                        CoastType[i]=1;
-                        if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=1;
-                            }
-                        }
-                        else {
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=3;
-                            }
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[2])==2) {
-                        CoastType[i]=0;
-                        //Checking ocean profile
-                        if (Ocean[4]==true) {
-                            OceanCoastType[i]=3;
-                        }
-                    }
-                    else {
-                        //Checking ocean profile
-                        if (Ocean[4]==true) {
-                            OceanCoastType[i]=3;
-                        }
-                    }
-                    break;
-                }
-                
-                //Checking 100100 case
-                else if (Ramps[0]==1 && Ramps[1]==0 && Ramps[2]==0 && Ramps[3]==1 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=4;
-                    CoastType[i]=4;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[3])==1) {
-                        CoastType[i]=1;
-                        if (CliffCoast[3]==0) {
-                            additionalCoastRotation=3;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[3])==2) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 111000 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==1 && Ramps[3]==0 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=5;
-                    CoastType[i]=5;
-                    
-                    //Checking cliff profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=2;
-                            additionalCoastRotation=1;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=2;
-                            }
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=3;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=3;
-                            }
-                        }
-                        else {
-                            CoastType[i]=2;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=3;
-                            }
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2])==2) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=2;
-                            }
-                        }
-                        else if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=1;
-                            }
-                        }
-                        else {
-                            //Checking ocean profile
-                            if (Ocean[4]==true) {
-                                OceanCoastType[i]=3;
-                            }
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2])==3) {
-                        CoastType[i]=0;
-                        //Checking ocean profile
-                        if (Ocean[4]==true) {
-                            OceanCoastType[i]=3;
-                        }
-                    }
-                    else {
-                        //Checking ocean profile
-                        if (Ocean[4]==true) {
-                            OceanCoastType[i]=3;
-                        }
-                    }
-                    break;
-                }
-                
-                //Checking 110100 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==0 && Ramps[3]==1 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=6;
-                    CoastType[i]=6;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=3;
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=4;
-                        }
-                        else {
-                            CoastType[i]=2;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3])==2) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[3]==0) {
-                            additionalCoastRotation=3;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3])==3) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 110010 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==0 && Ramps[3]==0 && Ramps[4]==1 && Ramps[5]==0) {
-                    RampType[i]=7;
-                    CoastType[i]=7;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[4])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=4;
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=3;
-                            additionalCoastRotation=4;
-                        }
-                        else {
-                            CoastType[i]=2;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[4])==2) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[4])==3) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 101010 case
-                else if (Ramps[0]==1 && Ramps[1]==0 && Ramps[2]==1 && Ramps[3]==0 && Ramps[4]==1 && Ramps[5]==0) {
-                    RampType[i]=8;
-                    CoastType[i]=8;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[2]+CliffCoast[4])==1) {
-                        CoastType[i]=3;
-                        if (CliffCoast[0]==1) {
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[2]==1) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[2]+CliffCoast[4])==2) {
-                        CoastType[i]=1;
-                        if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[2]+CliffCoast[4])==3) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 111100 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==1 && Ramps[3]==1 && Ramps[4]==0 && Ramps[5]==0) {
-                    RampType[i]=9;
-                    CoastType[i]=9;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=5;
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=7;
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[2]==1) {
-                            CoastType[i]=6;
-                        }
-                        else {
-                            CoastType[i]=5;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3])==2) {
-                        if (CliffCoast[0]==0) {
-                            if (CliffCoast[1]==0) {
-                                CoastType[i]=2;
-                            }
-                            else if (CliffCoast[2]==0) {
-                                CoastType[i]=3;
-                            }
-                            else {
-                                CoastType[i]=4;
-                            }
-                        }
-                        else if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            if (CliffCoast[2]==0) {
-                                CoastType[i]=2;
-                            }
-                            else {
-                                CoastType[i]=3;
-                            }
-                        }
-                        else {
-                            CoastType[i]=2;
-                            additionalCoastRotation=2;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3])==3) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[3]==0) {
-                            additionalCoastRotation=3;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3])==4) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 111010 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==1 && Ramps[3]==0 && Ramps[4]==1 && Ramps[5]==0) {
-                    RampType[i]=10;
-                    CoastType[i]=10;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[4])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=6;
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=8;
-                        }
-                        else if (CliffCoast[2]==1) {
-                            CoastType[i]=7;
-                        }
-                        else {
-                            CoastType[i]=5;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[4])==2) {
-                        if (CliffCoast[0]==0) {
-                            if (CliffCoast[1]==0) {
-                                CoastType[i]=2;
-                            }
-                            else if (CliffCoast[2]==0) {
-                                CoastType[i]=3;
-                            }
-                            else {
-                                CoastType[i]=3;
-                                additionalCoastRotation=4;
-                            }
-                        }
-                        else if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            if (CliffCoast[2]==0) {
-                                CoastType[i]=2;
-                            }
-                            else {
-                                CoastType[i]=4;
-                            }
-                        }
-                        else {
-                            CoastType[i]=3;
-                            additionalCoastRotation=2;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[4])==3) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[4])==4) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 110110 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==0 && Ramps[3]==1 && Ramps[4]==1 && Ramps[5]==0) {
-                    RampType[i]=11;
-                    CoastType[i]=11;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3]+CliffCoast[4])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=7;
-                            additionalCoastRotation=3;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=6;
-                            additionalCoastRotation=3;
-                        }
-                        else if (CliffCoast[3]==1) {
-                            CoastType[i]=7;
-                        }
-                        else {
-                            CoastType[i]=6;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3]+CliffCoast[4])==2) {
-                        if (CliffCoast[0]==0) {
-                            if (CliffCoast[1]==0) {
-                                CoastType[i]=2;
-                            }
-                            else if (CliffCoast[3]==0) {
-                                CoastType[i]=4;
-                            }
-                            else {
-                                CoastType[i]=3;
-                                additionalCoastRotation=4;
-                            }
-                        }
-                        else if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            if (CliffCoast[3]==0) {
-                                CoastType[i]=3;
-                            }
-                            else {
-                                CoastType[i]=4;
-                            }
-                        }
-                        else {
-                            CoastType[i]=2;
-                            additionalCoastRotation=3;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3]+CliffCoast[4])==3) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[3]==0) {
-                            additionalCoastRotation=3;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[3]+CliffCoast[4])==4) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //Checking 111110 case
-                else if (Ramps[0]==1 && Ramps[1]==1 && Ramps[2]==1 && Ramps[3]==1 && Ramps[4]==1 && Ramps[5]==0) {
-                    RampType[i]=12;
-                    CoastType[i]=12;
-                    
-                    //Checking cliff profile; no possible ocean profile
-                    if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4])==1) {
-                        if (CliffCoast[0]==1) {
-                            CoastType[i]=9;
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[1]==1) {
-                            CoastType[i]=10;
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[2]==1) {
-                            CoastType[i]=11;
-                        }
-                        else if (CliffCoast[3]==1) {
-                            CoastType[i]=10;
-                        }
-                        else {
-                            CoastType[i]=9;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4])==2) {
-                        if (CliffCoast[0]==1) {
-                            if (CliffCoast[1]==1) {
-                                CoastType[i]=5;
-                                additionalCoastRotation=2;
-                            }
-                            else if (CliffCoast[2]==1) {
-                                CoastType[i]=7;
-                                additionalCoastRotation=3;
-                            }
-                            else if (CliffCoast[3]==1) {
-                                CoastType[i]=6;
-                                additionalCoastRotation=1;
-                            }
-                            else {
-                                CoastType[i]=5;
-                                additionalCoastRotation=1;
-                            }
-                        }
-                        else if (CliffCoast[1]==1) {
-                            if (CliffCoast[2]==1) {
-                                CoastType[i]=6;
-                                additionalCoastRotation=3;
-                            }
-                            else if (CliffCoast[3]==1) {
-                                CoastType[i]=8;
-                            }
-                            else {
-                                CoastType[i]=7;
-                                additionalCoastRotation=2;
-                            }
-                        }
-                        else if (CliffCoast[2]==1) {
-                            if (CliffCoast[3]==1) {
-                                CoastType[i]=7;
-                            }
-                            else {
-                                CoastType[i]=6;
-                            }
-                        }
-                        else {
-                            CoastType[i]=5;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4])==3) {
-                        if (CliffCoast[0]==0) {
-                            if (CliffCoast[1]==0) {
-                                CoastType[i]=2;
-                            }
-                            else if (CliffCoast[2]==0) {
-                                CoastType[i]=3;
-                            }
-                            else if (CliffCoast[3]==0) {
-                                CoastType[i]=4;
-                            }
-                            else {
-                                CoastType[i]=3;
-                                additionalCoastRotation=4;
-                            }
-                        }
-                        else if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                            if (CliffCoast[2]==0) {
-                                CoastType[i]=2;
-                            }
-                            else if (CliffCoast[3]==0) {
-                                CoastType[i]=3;
-                            }
-                            else {
-                                CoastType[i]=4;
-                            }
-                        }
-                        else if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                            if (CliffCoast[3]==0) {
-                                CoastType[i]=2;
-                            }
-                            else {
-                                CoastType[i]=3;
-                            }
-                        }
-                        else {
-                            CoastType[i]=2;
-                            additionalCoastRotation=3;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4])==4) {
-                        CoastType[i]=1;
-                        if (CliffCoast[1]==0) {
-                            additionalCoastRotation=1;
-                        }
-                        else if (CliffCoast[2]==0) {
-                            additionalCoastRotation=2;
-                        }
-                        else if (CliffCoast[3]==0) {
-                            additionalCoastRotation=3;
-                        }
-                        else if (CliffCoast[4]==0) {
-                            additionalCoastRotation=4;
-                        }
-                    }
-                    else if ((CliffCoast[0]+CliffCoast[1]+CliffCoast[2]+CliffCoast[3]+CliffCoast[4])==5) {
-                        CoastType[i]=0;
-                    }
-                    break;
-                }
-                
-                //No match with previous cases, so we rotate by 60 degrees and increase currentRotation by 1
-                else {
-                    temp = Ramps[0];
-                    Ramps[0] = Ramps[1];
-                    Ramps[1] = Ramps[2];
-                    Ramps[2] = Ramps[3];
-                    Ramps[3] = Ramps[4];
-                    Ramps[4] = Ramps[5];
-                    Ramps[5] = temp;
-                    temp = CliffCoast[0];
-                    CliffCoast[0] = CliffCoast[1];
-                    CliffCoast[1] = CliffCoast[2];
-                    CliffCoast[2] = CliffCoast[3];
-                    CliffCoast[3] = CliffCoast[4];
-                    CliffCoast[4] = CliffCoast[5];
-                    CliffCoast[5] = temp;
-                    bool tempb;
-                    tempb = Ocean[0];
-                    Ocean[0] = Ocean[1];
-                    Ocean[1] = Ocean[2];
-                    Ocean[2] = Ocean[3];
-                    Ocean[3] = Ocean[4];
-                    Ocean[4] = Ocean[5];
-                    Ocean[5] = tempb;
-                    currentRotation++;
-                }
+    }
+    
+    int32 ChainLength = 6;
+    int32 ChainActual;
+
+    //Markov chains similar to the ones used to generate altitude map; starts somewhere and then moves randomly around for a randomized length, transforming every land tile to desert (except snow)
+    //Every seed draws from its own stream, and chains only ever turn tiles to desert, so the order of the chains doesn't matter
+    for (int32 i=0; i<potentialSeeds.Num(); i++) {
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::Deserts, potentialSeeds[i]);
+        if (random.RandRange(0, 3) != 0) {//Removing approx 3/4 of desert seeds
+            continue;
+        }
+        int32 Chain=random.RandRange(1, ChainLength*2);
+        
+        ChainActual=potentialSeeds[i];
+        
+        for (int32 j=0; j<Chain; j++) {
+            if ((TerrainType[ChainActual] != ETerrain::VE_Coast) && (TerrainType[ChainActual] != ETerrain::VE_Snow)) { //If terrain is not water or snow, set to desert
+                TerrainType[ChainActual]=ETerrain::VE_Desert;
+            }
+            ChainActual=RandomNeighbor(*NeighborTable, ChainActual, random);
+        }
+    }
+}
+
+//Climate of the moisture mode, in tile units
+static const float ClimateEvaporation = 0.3f;    //Share of the missing moisture the air takes up over a water tile
+static const float ClimateRainRate = 0.12f;      //Share of its moisture the air loses as rain over a lowland tile
+static const float ClimateUpliftRain = 0.3f;     //Further share lost for every altitude level the air climbs; what is left makes the rain shadow behind heights
+static const float ClimateRiverMoisture = 0.5f;  //Added on tiles with a river
+static const float ClimateLakeMoisture = 0.3f;   //Added on tiles next to a lake
+
+//Sweeps the prevailing wind of row y across it, writing the rain of every tile to Moisture
+//Winds blow along the rows : easterlies in the tropics and near the poles, westerlies in between; the row is swept twice, as the map wraps around, and only the second sweep is kept
+void AC_MapGenerator::ComputeMoistureRow(int32 y)
+{
+    float latitude=(float)getLatitude(y*mapsizex)/FMath::Max(mapsizey/2, 1);
+    int32 step=((latitude >= 1.f/3.f) && (latitude < 2.f/3.f)) ? 1 : -1;
+    //Air sinks around a third of the way to the poles and hardly rains there, which makes the subtropical deserts
+    float subtropics=(latitude-0.3f)/0.12f;
+    float rainRate=ClimateRainRate*(1.f - 0.75f*FMath::Exp(-subtropics*subtropics));
+    
+    const TArray<int32>& toLake=GetDistanceField(EMapDistance::VE_Lake);
+    const TArray<int32>& toRiver=GetDistanceField(EMapDistance::VE_River);
+    int32 rowStart=y*mapsizex;
+    float airMoisture=0.f;
+    int32 previousAltitude=0;
+    for (int32 sweep=0; sweep<2; sweep++) {
+        for (int32 k=0; k<mapsizex; k++) {
+            int32 i=rowStart + ((step > 0) ? k : mapsizex-1-k);
+            ETerrain terrain=TerrainType[i];
+            int32 altitude=AltitudeMap[i];
+            float rain;
+            if ((terrain==ETerrain::VE_Coast) || (terrain==ETerrain::VE_Ocean) || (terrain==ETerrain::VE_Lake)) {
+                airMoisture+=(1.f-airMoisture)*ClimateEvaporation;
+                rain=airMoisture*rainRate;
+            }
+            else {
+                int32 climb=FMath::Max(altitude-previousAltitude, 0);
+                rain=airMoisture*FMath::Min(rainRate + climb*ClimateUpliftRain, 1.f);
+                airMoisture-=rain;
+            }
+            previousAltitude=altitude;
+            if (sweep==1) {
+                Moisture[i]=rain/ClimateRainRate + ((toRiver[i]==0) ? ClimateRiverMoisture : 0.f) + ((toLake[i]==1) ? ClimateLakeMoisture : 0.f);
+            }
+        }
+    }
+}
+
+//Turns dry land to desert, and semi arid grassland to plain, from the moisture brought by the winds; snow and tundra are too cold to change
+//Rows don't share any wind, so they are done in parallel; no random numbers are involved
+void AC_MapGenerator::GenerateClimateDeserts()
+{
+    Moisture.SetNum(mapsizex*mapsizey);
+    ParallelFor(mapsizey, [this](int32 y) {
+        ComputeMoistureRow(y);
+        for (int32 i=y*mapsizex; i<(y+1)*mapsizex; i++) {
+            ETerrain terrain=TerrainType[i];
+            bool temperate=(terrain==ETerrain::VE_Grassland) || (terrain==ETerrain::VE_Plain);
+            if (temperate && (Moisture[i] < DesertMoisture)) {
+                TerrainType[i]=ETerrain::VE_Desert;
+            }
+            else if ((terrain==ETerrain::VE_Grassland) && (Moisture[i] < 2.f*DesertMoisture)) {
+                TerrainType[i]=ETerrain::VE_Plain;
             }
         }
-        RampRotation[i]=currentRotation;
-        CoastRotation[i]=currentRotation+additionalCoastRotation;
+    });
+}
+
+
+//Takes in a altitude map and determines where ramps should be placed on every hex in the map, in the form of 2 1D arrays. See .h for hex ramp types, rotations are multiples of +60 degrees (0,1,2,3,4,5)
+//Uses unreduced AltitudeMap and TerrainType arrays (to check if terrain is water), so has to be placed between GenerateTerrainType and ReduceLandAltitude
+void AC_MapGenerator::GetHexTypesAndRotations()
+{
+    if (IsRefusedDuringGeneration(TEXT("GetHexTypesAndRotations"))) {
+        return;
+    }
+    int32 mapsize = mapsizex*mapsizey;
+    
+    RampType.SetNum(mapsize);
+    CoastType.SetNum(mapsize);
+    OceanCoastType.SetNum(mapsize);
+    RampRotation.SetNum(mapsize);
+    CoastRotation.SetNum(mapsize);
+    
+    //Determining configuration of neighbors for position of ramps/coasts : every neighbor is read as its altitude, plus 4 if it is an ocean hex
+    TArray<uint8> isOcean;
+    ComputeOceanTiles(isOcean);
+    TArray<uint8> neighborInfo;
+    neighborInfo.SetNumUninitialized(mapsize);
+    for (int32 i=0; i<mapsize; i++) {
+        neighborInfo[i]=(uint8)(AltitudeMap[i] | (isOcean[i] << 2));
     }
+    uint8 const outside=0xFF;//Out-of-map neighbors don't add anything
+    TArray<int32> neighborMasks;//Ramp, cliff and ocean masks, 6 bits each
+    NeighborTable->ApplyStencil(neighborInfo, outside, neighborMasks, [this, outside](int32 i, const uint8* neighbors) {
+        int32 rampMask=0;
+        int32 cliffMask=0;
+        int32 oceanMask=0;
+        int32 isCoast=((TerrainType[i] == ETerrain::VE_Coast) | (TerrainType[i] == ETerrain::VE_Lake));
+        for (int32 j=0; j<6; j++) {
+            int32 onMap=(neighbors[j] != outside);
+            int32 altitudeDifference=(neighbors[j] & 3)-AltitudeMap[i];
+            int32 isCliff=isCoast & (altitudeDifference > 1);//For cases of coasts next to cliffs
+            rampMask |= (onMap & ((altitudeDifference == 1) | isCliff)) << j;
+            cliffMask |= (onMap & isCliff) << j;
+            oceanMask |= (onMap & isCoast & (altitudeDifference < 1) & (neighbors[j] >> 2)) << j;//Checks if neighbor is an ocean hex
+        }
+        return rampMask | (cliffMask << 6) | (oceanMask << 12);
+    });
+    
+    //Determining the type and rotation of each tile from the configuration of its neighbors; tiles only read their own masks, so rows are done in parallel
+    ParallelFor(mapsizey, [this, &neighborMasks](int32 y) {
+        for (int32 i=y*mapsizex; i<(y+1)*mapsizex; i++) {
+            int32 rampMask=neighborMasks[i] & 63;
+            int32 cliffMask=(neighborMasks[i] >> 6) & 63;
+            int32 oceanMask=(neighborMasks[i] >> 12) & 63;
+            
+            //Rotating the cliffs and oceans the same way as the ramps, so that they can be matched against the canonical ramp pattern
+            int32 ramp=HexRampTable[rampMask];
+            int32 rampType=ramp & 15;
+            int32 rotation=ramp >> 4;
+            cliffMask=RotateHexMask(cliffMask, rotation);
+            oceanMask=RotateHexMask(oceanMask, rotation);
+            int32 coast=HexCoastTable[rampType][cliffMask];
+            
+            RampType[i]=rampType;
+            CoastType[i]=coast & 15;
+            OceanCoastType[i]=HexOceanCoastTable[rampType][HexOceanIndex(cliffMask, oceanMask)];
+            if (coast & HexRandomRotationFlag) {//Symmetric pattern, any rotation fits
+                RampRotation[i]=FMapRandom::RandRange(UsedSeed, EMapRandomStage::HexTypes, i, 0, 0, 5);
+                CoastRotation[i]=RampRotation[i];
+            }
+            else {
+                RampRotation[i]=rotation;
+                CoastRotation[i]=rotation+((coast >> 4) & 7);
+            }
+        }
+    });
 }
 
 //Reduces altitude of all non-water terrain by 1 so that the lowest land level is at the same level as water; also reduces altitude of all rivers
 void AC_MapGenerator::ReduceLandAltitude()
 {
+    if (IsRefusedDuringGeneration(TEXT("ReduceLandAltitude"))) {
+        return;
+    }
     int32 mapsize = mapsizex*mapsizey;
     for (int32 i=0; i<mapsize; i++) {
         if ((TerrainType[i]!=ETerrain::VE_Coast) && (TerrainType[i]!=ETerrain::VE_Ocean) && (TerrainType[i]!=ETerrain::VE_Lake)) {
@@ -2142,24 +1667,73 @@ void AC_MapGenerator::ReduceLandAltitude()
     }
 }
 
-//Places forests on land tiles
+//Places forests on land tiles, as set by ForestMode
 void AC_MapGenerator::PlaceForests() {
-    int32 mapsize = mapsizex*mapsizey;
+    if (IsRefusedDuringGeneration(TEXT("PlaceForests"))) {
+        return;
+    }
+    Forests.Init(0, mapsizex*mapsizey);
+    if (ForestMode==EForestMode::VE_BlueNoise) {
+        PlaceBlueNoiseForests();
+    }
+    else {
+        PlaceCoinFlipForests();
+    }
+}
+
+//Every land tile draws on its own, so they are done in parallel
+void AC_MapGenerator::PlaceCoinFlipForests() {
     int32 landsize = LandTiles.Num();
-    Forests.SetNumZeroed(mapsizex*mapsizey);
-    for (int32 i=0; i<landsize; i++) {
-        int32 latitude = getApparentLatitude(LandTiles[i]);
-        if ((randomstream.RandRange(0, latitude*latitude)) < (latitude + 4)) {
-            if ((TerrainType[LandTiles[i]] != ETerrain::VE_Snow) && (TerrainType[LandTiles[i]] != ETerrain::VE_Desert)) {//No forests on snow and deserts
-                Forests[LandTiles[i]]=1;
+    ParallelFor(landsize, [this](int32 i) {
+        int32 tile = LandTiles[i];
+        int32 latitude = getApparentLatitude(tile);
+        if ((FMapRandom::RandRange(UsedSeed, EMapRandomStage::Forests, tile, 0, 0, latitude*latitude)) < (latitude + 4)) {
+            if ((TerrainType[tile] != ETerrain::VE_Snow) && (TerrainType[tile] != ETerrain::VE_Desert)) {//No forests on snow and deserts
+                Forests[tile]=1;
             }
         }
+    });
+}
+
+//Blue noise sampling keeps about this share of the tiles with a spacing of 1 (times 1/spacing^2 for bigger spacings)
+static const float ForestSpacingShare = 0.45f;
+//Tiles asking for sparser forests than that get none
+static const float ForestMaxSpacing = 5.f;
+
+//Forests spread out evenly over the land, with a spacing set by the share of forest wanted on every tile : the coin flip chance of its apparent latitude,
+//times its moisture when the climate has one. Single threaded, as every tile depends on the forests already placed, but linear in the number of land tiles
+void AC_MapGenerator::PlaceBlueNoiseForests() {
+    TArray<int32> candidates;
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        if ((TerrainType[LandTiles[i]] != ETerrain::VE_Snow) && (TerrainType[LandTiles[i]] != ETerrain::VE_Desert)) {//No forests on snow and deserts
+            candidates.Add(LandTiles[i]);
+        }
+    }
+    bool hasMoisture=(Moisture.Num()==mapsizex*mapsizey);
+    
+    FHexBlueNoiseSampler sampler(mapsizex, mapsizey, ForestMaxSpacing);
+    FMapRandomStream random=GetRandomStream(EMapRandomStage::ForestSampling, 0);
+    TArray<int32> samples;
+    sampler.Sample(candidates, random, [this, hasMoisture](int32 tile) {
+        int32 latitude = FMath::Max(getApparentLatitude(tile), 0);
+        float share = FMath::Min((latitude + 4.f)/(latitude*latitude + 1.f), 1.f)*ForestDensity;
+        if (hasMoisture) {
+            share*=FMath::Clamp(Moisture[tile], 0.f, 1.f);
+        }
+        return (share > 0.f) ? FMath::Sqrt(ForestSpacingShare/share) : 0.f;
+    }, samples);
+    for (int32 i=0; i<samples.Num(); i++) {
+        Forests[samples[i]]=1;
     }
 }
 
 //Places resources on tiles; needs to be placed after ReduceLandAltitude.
 void AC_MapGenerator::PlaceResources() {
-    TArray<int32> LandResourceSpots, WaterResourceSpots;
+    if (IsRefusedDuringGeneration(TEXT("PlaceResources"))) {
+        return;
+    }
+    FMemMark Mark(FMemStack::Get());
+    TArray<int32, TMemStackAllocator<>> LandResourceSpots, WaterResourceSpots;
     resources.SetNum(mapsizex*mapsizey);
     resourceRotations.SetNum(mapsizex*mapsizey);
     
@@ -2170,61 +1744,42 @@ void AC_MapGenerator::PlaceResources() {
     
     //Sample land tiles
     for (int32 i=0; i<LandTiles.Num(); i++) {
-        resourceRotations[LandTiles[i]] = randomstream.RandRange(0, 5);
-        if (randomstream.RandRange(1, 10) == 10) {
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::ResourceSpots, LandTiles[i]);
+        resourceRotations[LandTiles[i]] = random.RandRange(0, 5);
+        if (random.RandRange(1, 10) == 10) {
             LandResourceSpots.Push(LandTiles[i]);
         }
     }
     
     //Sample water tiles
     for (int32 i=0; i<WaterTiles.Num(); i++) {
-        if (randomstream.RandRange(1, 10) == 10) {
+        if (FMapRandom::RandRange(UsedSeed, EMapRandomStage::ResourceSpots, WaterTiles[i], 0, 1, 10) == 10) {
             WaterResourceSpots.Push(WaterTiles[i]);
         }
     }
     
-    //Place land resources according to the characteristics or the tile
-    for (int32 i=0; i<LandResourceSpots.Num(); i++) {
-        int32 x = getX(LandResourceSpots[i]);
-        int32 y = getY(LandResourceSpots[i]);
+    //Place land resources according to the characteristics or the tile; every spot draws from its own stream and only writes its own tile, so spots are done in parallel
+    ParallelFor(LandResourceSpots.Num(), [this, &LandResourceSpots](int32 i) {
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::Resources, LandResourceSpots[i]);
         int32 randres;
         
         //QUARRIES
         if (AltitudeMap[LandResourceSpots[i]] == 0) {//Checking for quarry resource spots (bottom of a cliff)
-            bool legitQuarrySpot=false;
+            //Sides of the tile along a cliff without a river, any of which the quarry can face
+            int32 cliffSides[6];
+            int32 numberOfCliffSides=0;
             for (int32 j=1; j<7; j++) {
-                int32 current = getNeighbor(x, y, j);
+                int32 current = getNeighbor(LandResourceSpots[i], j);
                 if (current != -1) {
-                    if (AltitudeMap[current] == 2) {
-                        switch (j) {
-                            case 1:
-                                if (RiverOn1[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            case 2:
-                                if (RiverOn2[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            case 3:
-                                if (RiverOn3[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            case 4:
-                                if (RiverOn4[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            case 5:
-                                if (RiverOn5[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            case 6:
-                                if (RiverOn6[LandResourceSpots[i]] == 0) legitQuarrySpot=true;
-                                break;
-                            default:
-                                break;
-                        }
+                    if ((AltitudeMap[current] == 2) && !IsRiverOn(LandResourceSpots[i], j)) {
+                        cliffSides[numberOfCliffSides++]=j;
                     }
                 }
             }
-            if (legitQuarrySpot) {
+            if (numberOfCliffSides > 0) {
                 switch (TerrainType[LandResourceSpots[i]]) {
                     case ETerrain::VE_Grassland:
-                        randres=randomstream.RandRange(1, 5);
+                        randres=random.RandRange(1, 5);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2241,7 +1796,7 @@ void AC_MapGenerator::PlaceResources() {
                         }
                         break;
                     case ETerrain::VE_Plain:
-                        randres=randomstream.RandRange(1, 4);
+                        randres=random.RandRange(1, 4);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2255,7 +1810,7 @@ void AC_MapGenerator::PlaceResources() {
                         }
                         break;
                     case ETerrain::VE_Tundra:
-                        randres=randomstream.RandRange(1, 2);
+                        randres=random.RandRange(1, 2);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2271,7 +1826,7 @@ void AC_MapGenerator::PlaceResources() {
                         resources[LandResourceSpots[i]]=EResource::VE_Limestone;
                         break;
                     case ETerrain::VE_Desert:
-                        randres=randomstream.RandRange(1, 2);
+                        randres=random.RandRange(1, 2);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2286,81 +1841,31 @@ void AC_MapGenerator::PlaceResources() {
                     default:
                         break;
                 }
-                bool rotationFound = false;
-                while (!rotationFound) {
-                    randres=randomstream.RandRange(1, 6);
-                    int32 current = getNeighbor(x, y, randres);
-                    if (current != -1) {
-                        if (AltitudeMap[current] == 2) {
-                            switch (randres) {
-                                case 1:
-                                    if (RiverOn1[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=0;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                case 2:
-                                    if (RiverOn2[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=1;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                case 3:
-                                    if (RiverOn3[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=2;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                case 4:
-                                    if (RiverOn4[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=3;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                case 5:
-                                    if (RiverOn5[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=4;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                case 6:
-                                    if (RiverOn6[LandResourceSpots[i]] == 0) {
-                                        resourceRotations[LandResourceSpots[i]]=5;
-                                        rotationFound=true;
-                                    }
-                                    break;
-                                default:
-                                    break;
-                            }
-                            {
-                                GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("placing a cliff quarry resource"));
-                            }
-                        }
-                    }
-                }
-                continue;//skip the other resource placements and go to next resources
+                resourceRotations[LandResourceSpots[i]]=cliffSides[random.RandRange(0, numberOfCliffSides-1)]-1;
+                UE_LOG(LogMapGeneration, Verbose, TEXT("placing a cliff quarry resource"));
+                return;//skip the other resource placements and go to next resources
             }
         }
         else if (AltitudeMap[LandResourceSpots[i]] == 2){ //Flat quarry spots on plateaus
             bool legitFlatQuarrySpot=true;
             for (int32 j=1; j<7; j++) {
-                int32 current = getNeighbor(x, y, j);
+                int32 current = getNeighbor(LandResourceSpots[i], j);
                 if (current != -1) {
                     if (AltitudeMap[current] != AltitudeMap[LandResourceSpots[i]]) {
                         legitFlatQuarrySpot=false;
                     }
                 }
             }
-            if ((RiverOn1[LandResourceSpots[i]] == 1) || (RiverOn2[LandResourceSpots[i]] == 1) || (RiverOn3[LandResourceSpots[i]] == 1) || (RiverOn4[LandResourceSpots[i]] == 1) || (RiverOn5[LandResourceSpots[i]] == 1) || (RiverOn6[LandResourceSpots[i]] == 1)) {
+            if (RiverEdges[LandResourceSpots[i]] != 0) {
                 legitFlatQuarrySpot=false;
             }
-            if (randomstream.RandRange(1, 4) != 1) {
+            if (random.RandRange(1, 4) != 1) {
                 legitFlatQuarrySpot=false;
             }
             if (legitFlatQuarrySpot) {
                 switch (TerrainType[LandResourceSpots[i]]) {
                     case ETerrain::VE_Grassland:
-                        randres=randomstream.RandRange(1, 5);
+                        randres=random.RandRange(1, 5);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2377,7 +1882,7 @@ void AC_MapGenerator::PlaceResources() {
                         }
                         break;
                     case ETerrain::VE_Plain:
-                        randres=randomstream.RandRange(1, 4);
+                        randres=random.RandRange(1, 4);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2391,7 +1896,7 @@ void AC_MapGenerator::PlaceResources() {
                         }
                         break;
                     case ETerrain::VE_Tundra:
-                        randres=randomstream.RandRange(1, 2);
+                        randres=random.RandRange(1, 2);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2407,7 +1912,7 @@ void AC_MapGenerator::PlaceResources() {
                         resources[LandResourceSpots[i]]=EResource::VE_Limestone;
                         break;
                     case ETerrain::VE_Desert:
-                        randres=randomstream.RandRange(1, 2);
+                        randres=random.RandRange(1, 2);
                         switch (randres) {
                             case 1:
                                 resources[LandResourceSpots[i]]=EResource::VE_Limestone;
@@ -2422,125 +1927,650 @@ void AC_MapGenerator::PlaceResources() {
                     default:
                         break;
                 }
-                if (GEngine)
-                {
-                    GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("placing a quarry resource"));
-                }
-                continue;//skip the other resource placements and go to next resources
+                UE_LOG(LogMapGeneration, Verbose, TEXT("placing a quarry resource"));
+                return;//skip the other resource placements and go to next resources
             }
         }
         
         
-        resourceRotations[LandResourceSpots[i]] = randomstream.RandRange(0, 5);
-        int typerand=randomstream.RandRange(0, 15);
+        resourceRotations[LandResourceSpots[i]] = random.RandRange(0, 5);
+        int typerand=random.RandRange(0, 15);
+        EImprovement family;
         //MINE RESOURCES
         if (typerand < 3) {
-            if (GEngine)
-            {
-                GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("placing a mine resource"));
-            }
-            
-            randres=randomstream.RandRange(0,18);
-            if (randres < 4) {
-                resources[LandResourceSpots[i]]=EResource::VE_Copper;
-            }
-            else if (randres < 6) {
-                resources[LandResourceSpots[i]]=EResource::VE_Iron;
-            }
-            else if (randres < 7) {
-                resources[LandResourceSpots[i]]=EResource::VE_Mithril;
-            }
-            else if (randres < 11) {
-                resources[LandResourceSpots[i]]=EResource::VE_Gems;
-            }
-            else if (randres < 15) {
-                resources[LandResourceSpots[i]]=EResource::VE_Gold;
-            }
-            else {
-                resources[LandResourceSpots[i]]=EResource::VE_Silver;
-            }
+            family=EImprovement::VE_Mine;
         }
         //PLANTATION RESOURCES
         else if (typerand < 6) {
-            
+            family=EImprovement::VE_Plantation;
         }
         //PASTURE RESOURCES
         else if (typerand < 9) {
-            
+            family=EImprovement::VE_Pasture;
         }
         //CAMP RESOURCES
         else if (typerand < 11) {
-            
+            family=EImprovement::VE_Camp;
         }
         //FARM RESOURCES
         else if (typerand < 15) {
-            
+            family=EImprovement::VE_Farm;
         }
         //LUMBERMILL RESOURCES
         else {
-            
+            family=EImprovement::VE_Lumbermill;
+        }
+        //Left empty if no resource of the family fits the tile
+        resources[LandResourceSpots[i]]=PickResource(LandResourceSpots[i], family, 0, random);
+    });
+    
+    //FISHING BOAT RESOURCES
+    ParallelFor(WaterResourceSpots.Num(), [this, &WaterResourceSpots](int32 i) {
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::Resources, WaterResourceSpots[i]);
+        resourceRotations[WaterResourceSpots[i]] = random.RandRange(0, 5);
+        resources[WaterResourceSpots[i]]=PickResource(WaterResourceSpots[i], EImprovement::VE_FishingBoat, 0, random);
+    });
+}
+
+//Picks a resource of ResourceRules fitting the tile, of 'family' (any family for VE_None) and with every flag of 'kind' (ResourceStrategic...); VE_None if there is none
+//Uses a single draw
+EResource AC_MapGenerator::PickResource(int32 tile, EImprovement family, uint8 kind, FMapRandomStream& random) {
+    uint16 terrain=ResourceTerrainBit(TerrainType[tile]);
+    uint8 excluded=(Forests[tile] != 0) ? ResourceNoForest : ResourceNeedsForest;
+    if (freshWater[tile] == 0) {
+        excluded|=ResourceNeedsFreshWater;
+    }
+    
+    int32 fits[NumberOfResourceRules];
+    int32 numberOfFits=0;
+    int32 totalWeight=0;
+    for (int32 j=0; j<NumberOfResourceRules; j++) {
+        const FResourceRule& rule=ResourceRules[j];
+        if (((family == EImprovement::VE_None) || (rule.Family == family)) && ((rule.Terrains & terrain) != 0) && ((rule.Flags & excluded) == 0) && ((rule.Flags & kind) == kind)) {
+            fits[numberOfFits++]=j;
+            totalWeight+=rule.Weight;
         }
+    }
+    if (numberOfFits == 0) {
+        return EResource::VE_None;
+    }
+    int32 randres=random.RandRange(0, totalWeight-1);
+    for (int32 j=0; j<numberOfFits; j++) {
+        randres-=ResourceRules[fits[j]].Weight;
+        if (randres < 0) {
+            return ResourceRules[fits[j]].Resource;
+        }
+    }
+    return EResource::VE_None;
+}
+
+//Tops every start region up to StrategicResourcesPerRegion strategic and LuxuryResourcesPerRegion luxury resources, on free tiles where they fit
+//Every region draws from its own stream and only writes its own tiles, so regions are done in parallel; the starting spots are scored again afterwards
+void AC_MapGenerator::PlaceResourceQuotas() {
+    if (IsRefusedDuringGeneration(TEXT("PlaceResourceQuotas"))) {
+        return;
+    }
+    int32 numberOfRegions=StartRegionSeeds.Num();
+    if (numberOfRegions == 0) {
+        return;
+    }
+    
+    //Tiles of every region, grouped with a counting sort : region r has the tiles of regionTiles from regionStarts[r] to regionStarts[r+1]
+    FMemMark Mark(FMemStack::Get());
+    int32 mapsize=mapsizex*mapsizey;
+    TArray<int32, TMemStackAllocator<>> regionStarts;
+    regionStarts.SetNumZeroed(numberOfRegions+1);
+    for (int32 i=0; i<mapsize; i++) {
+        regionStarts[StartRegionOfTile[i]+1]++;
+    }
+    for (int32 r=0; r<numberOfRegions; r++) {
+        regionStarts[r+1]+=regionStarts[r];
+    }
+    TArray<int32, TMemStackAllocator<>> regionTiles;
+    regionTiles.SetNumUninitialized(mapsize);
+    TArray<int32, TMemStackAllocator<>> filled(regionStarts);
+    for (int32 i=0; i<mapsize; i++) {
+        regionTiles[filled[StartRegionOfTile[i]]++]=i;
+    }
+    
+    ParallelFor(numberOfRegions, [this, &regionStarts, &regionTiles](int32 r) {
+        int32 first=regionStarts[r];
+        int32 count=regionStarts[r+1]-first;
+        int32* tiles=regionTiles.GetData()+first;
         
+        //What the region already got
+        int32 missingStrategic=StrategicResourcesPerRegion;
+        int32 missingLuxury=LuxuryResourcesPerRegion;
+        for (int32 i=0; i<count; i++) {
+            for (int32 j=0; j<NumberOfResourceRules; j++) {
+                if (ResourceRules[j].Resource == resources[tiles[i]]) {
+                    missingStrategic-=((ResourceRules[j].Flags & ResourceStrategic) != 0);
+                    missingLuxury-=((ResourceRules[j].Flags & ResourceLuxury) != 0);
+                    break;
+                }
+            }
+        }
         
+        //Free tiles in a random order (Fisher-Yates shuffle of the region's tiles), each taking a missing resource if one fits
+        FMapRandomStream random=GetRandomStream(EMapRandomStage::ResourceQuotas, r);
+        for (int32 i=count-1; i>0; i--) {
+            int32 j=random.RandRange(0, i);
+            int32 tile=tiles[i];
+            tiles[i]=tiles[j];
+            tiles[j]=tile;
+        }
+        for (int32 i=0; (i<count) && ((missingStrategic > 0) || (missingLuxury > 0)); i++) {
+            if (resources[tiles[i]] != EResource::VE_None) {
+                continue;
+            }
+            EResource resource=EResource::VE_None;
+            if (missingStrategic > 0) {
+                resource=PickResource(tiles[i], EImprovement::VE_None, ResourceStrategic, random);
+                missingStrategic-=(resource != EResource::VE_None);
+            }
+            if ((resource == EResource::VE_None) && (missingLuxury > 0)) {
+                resource=PickResource(tiles[i], EImprovement::VE_None, ResourceLuxury, random);
+                missingLuxury-=(resource != EResource::VE_None);
+            }
+            if (resource != EResource::VE_None) {
+                resources[tiles[i]]=resource;
+                resourceRotations[tiles[i]]=random.RandRange(0, 5);
+            }
+        }
+        if ((missingStrategic > 0) || (missingLuxury > 0)) {
+            UE_LOG(LogMapGeneration, Log, TEXT("Start region %d is short of %d strategic and %d luxury resources"), r, FMath::Max(missingStrategic, 0), FMath::Max(missingLuxury, 0));
+        }
+    });
+    
+    TArray<int32> scores;
+    ScoreStartSites(scores);
+    for (int32 i=0; i<StartingSpots.Num(); i++) {
+        StartSpotScores[i]=scores[StartingSpots[i]];
+    }
+}
+
+//Splits the map into start regions, one around every starting spot : every tile goes to the closest spot, so that the resource quotas of a region go to the civ starting there
+void AC_MapGenerator::BuildStartRegions() {
+    if (IsRefusedDuringGeneration(TEXT("BuildStartRegions"))) {
+        return;
+    }
+    StartRegionSeeds=StartingSpots;
+    StartRegionOfTile.Init(0, mapsizex*mapsizey);
+    if (StartRegionSeeds.Num() > 0) {
+        NeighborTable->ComputeNearestSeeds(StartRegionSeeds, StartRegionOfTile);
     }
 }
 
 void AC_MapGenerator::PlaceImprovements() {
+    if (IsRefusedDuringGeneration(TEXT("PlaceImprovements"))) {
+        return;
+    }
     improvements.SetNum(mapsizex*mapsizey);
     for (int32 i=0; i<(mapsizex*mapsizey); i++) {
         improvements[i]=EImprovement::VE_None;
     }
 }
 
-//Fills up the StartingSpots array with decent starting spots AT THE MOMENT ITS JUST A RANDOM LAND TILE
+//Start spot scores : what a city on the tile would get from the tiles around it, plus this for founding it next to fresh water
+static const int32 StartFreshWaterValue = 4;
+
+//Worth of a tile for a city around it : its unimproved yields, as AC_HexTile::CalcTileYields has them (food and production counting twice), and its resource
+int32 AC_MapGenerator::getSiteValue(int32 index){
+    int32 food=0;
+    int32 prod=0;
+    int32 coin=0;
+    switch (TerrainType[index]) {
+        case ETerrain::VE_Coast:
+            food=1;
+            coin=1;
+            break;
+        case ETerrain::VE_Lake:
+            food=2;
+            coin=1;
+            break;
+        case ETerrain::VE_Grassland:
+            food=2;
+            break;
+        case ETerrain::VE_Plain:
+            food=1;
+            prod=1;
+            break;
+        case ETerrain::VE_Tundra:
+            food=1;
+            break;
+        default:
+            break;
+    }
+    if (Forests[index] == 1) {
+        prod++;
+    }
+    if (freshWater[index] == 2) {
+        coin++;
+        if (TerrainType[index] == ETerrain::VE_Desert) {//floodplain
+            food=3;
+        }
+    }
+    int32 value=2*food + 2*prod + coin;
+    if (resources[index] != EResource::VE_None) {
+        value+=2;
+        for (int32 j=0; j<NumberOfResourceRules; j++) {
+            if (ResourceRules[j].Resource == resources[index]) {
+                value+=((ResourceRules[j].Flags & (ResourceStrategic | ResourceLuxury)) != 0) ? 2 : 0;
+                break;
+            }
+        }
+    }
+    return value;
+}
+
+//Scores every land tile as a starting spot : the sum of site values over the tiles at most StartSpotRadius away (see FHexNeighborTable::SumOverDiscs), plus fresh water
+void AC_MapGenerator::ScoreStartSites(TArray<int32>& outScores) {
+    int32 mapsize=mapsizex*mapsizey;
+    TArray<int32> siteValues;
+    siteValues.SetNumUninitialized(mapsize);
+    ParallelFor(mapsizey, [this, &siteValues](int32 y) {
+        for (int32 i=y*mapsizex; i<(y+1)*mapsizex; i++) {
+            siteValues[i]=getSiteValue(i);
+        }
+    });
+    NeighborTable->SumOverDiscs(siteValues, StartSpotRadius, outScores);
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        outScores[LandTiles[i]]+=(freshWater[LandTiles[i]] != 0) ? StartFreshWaterValue : 0;
+    }
+}
+
+/*Fills up the StartingSpots array with NumberOfCivs spots, spread out over the best sites.
+ Every land tile gets a score, the sum of site values over the tiles at most StartSpotRadius away (see FHexNeighborTable::SumOverDiscs), and the best
+ StartSpotCandidateShare of the land tiles are candidates. Spots are then picked by farthest point sampling over the candidates, from the best one.
+ */
 void AC_MapGenerator::GetStartingSpots() {
-    //StartingSpots.Push(214);
-    for (int32 i=0; i<10; i++) {
-        StartingSpots.Push(LandTiles[randomstream.RandRange(0, LandTiles.Num()-1)]);
+    if (IsRefusedDuringGeneration(TEXT("GetStartingSpots"))) {
+        return;
+    }
+    StartingSpots.Reset();
+    StartSpotScores.Reset();
+    int32 numberOfSpots=FMath::Max(NumberOfCivs, 1);
+    if (LandTiles.Num() == 0) {
+        return;
+    }
+    
+    TArray<int32> scores;
+    ScoreStartSites(scores);
+    
+    //Best candidate share, through a histogram of the scores; snow makes for poor starts
+    int32 maxScore=0;
+    int32 numberOfCandidates=0;
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        int32 tile=LandTiles[i];
+        if (TerrainType[tile] != ETerrain::VE_Snow) {
+            maxScore=FMath::Max(maxScore, scores[tile]);
+            numberOfCandidates++;
+        }
+    }
+    TArray<int32> histogram;
+    histogram.SetNumZeroed(maxScore+1);
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        if (TerrainType[LandTiles[i]] != ETerrain::VE_Snow) {
+            histogram[scores[LandTiles[i]]]++;
+        }
+    }
+    int32 wanted=FMath::Max(FMath::CeilToInt(numberOfCandidates*StartSpotCandidateShare), numberOfSpots);
+    int32 threshold=maxScore;
+    for (int32 count=histogram[maxScore]; (threshold > 0) && (count < wanted); count+=histogram[threshold]) {
+        threshold--;
+    }
+    
+    TArray<int32> candidates;
+    int32 best=-1;
+    for (int32 i=0; i<LandTiles.Num(); i++) {
+        int32 tile=LandTiles[i];
+        if ((TerrainType[tile] != ETerrain::VE_Snow) && (scores[tile] >= threshold)) {
+            candidates.Add(tile);
+            if ((best == -1) || (scores[tile] > scores[best])) {
+                best=tile;
+            }
+        }
+    }
+    if (best == -1) {//Only snow
+        best=LandTiles[0];
+    }
+    NeighborTable->PickFarthestTiles(best, numberOfSpots, candidates, StartingSpots);
+    
+    //Not enough candidates : the other land tiles make up for it
+    if (StartingSpots.Num() < numberOfSpots) {
+        StartingSpots.Reset();
+        NeighborTable->PickFarthestTiles(best, numberOfSpots, LandTiles, StartingSpots);
+    }
+    if (StartingSpots.Num() < numberOfSpots) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("Only %d land tiles for %d starting spots"), StartingSpots.Num(), numberOfSpots);
+    }
+    for (int32 i=0; i<StartingSpots.Num(); i++) {
+        StartSpotScores.Add(scores[StartingSpots[i]]);
     }
 }
 
 
+//Hands the generated map over to the game manager : the tile store and the hex arrays are moved, not copied, and the neighbor table is shared
+//The generation scratch data is released afterwards; save the map (SaveWorld) before this if needed
 void AC_MapGenerator::InitializeGameManager() {
+    if (IsRefusedDuringGeneration(TEXT("InitializeGameManager"))) {
+        return;
+    }
     
     manager->mapsizex=mapsizex;
     manager->mapsizey=mapsizey;
+    manager->NeighborTable=NeighborTable;
     
-    manager->AltitudeMap=TArray<int32>(AltitudeMap);
-    manager->TerrainType=TArray<ETerrain>(TerrainType);
-
-    manager->Forests=TArray<int32>(Forests);
-    manager->RiverOn1=TArray<int32>(RiverOn1);
-    manager->RiverOn2=TArray<int32>(RiverOn2);
-    manager->RiverOn3=TArray<int32>(RiverOn3);
-    manager->RiverOn4=TArray<int32>(RiverOn4);
-    manager->RiverOn5=TArray<int32>(RiverOn5);
-    manager->RiverOn6=TArray<int32>(RiverOn6);
-
-    manager->Resources=TArray<EResource>(resources);
-    manager->Improvements=TArray<EImprovement>(improvements);
-    
-    int32 mapsize = mapsizex*mapsizey;
-    initialCityDistricts.SetNum(mapsize);
-    for (int32 i=0; i<mapsize; i++) {
-        initialCityDistricts[i]=-1;
+    if (TileStore.IsValid()) {
+        //Loaded from a world file : the records are used in place, only the twin flags (known once the hexes are spawned) are missing
+        PackTwinFlags(*TileStore);
     }
-    manager->CityDistricts=TArray<int32>(initialCityDistricts);
+    else {
+        PackTileStore();
+    }
+    manager->TileStore=MoveTemp(TileStore);
     
-    manager->StartingSpots=TArray<int32>(StartingSpots);
+    manager->StartingSpots=MoveTemp(StartingSpots);
     
-    manager->PrimaryHexArray=TArray<AC_HexTile*>(PrimaryHexArray);
-    manager->PositiveTwinHexArray=TArray<AC_HexTile*>(PositiveTwinHexArray);
-    manager->NegativeTwinHexArray=TArray<AC_HexTile*>(NegativeTwinHexArray);
-    manager->hasPositiveTwin=TArray<bool>(hasPositiveTwin);
-    manager->hasNegativeTwin=TArray<bool>(hasNegativeTwin);
+    manager->PrimaryHexArray=MoveTemp(PrimaryHexArray);
+    manager->PositiveTwinHexArray=MoveTemp(PositiveTwinHexArray);
+    manager->NegativeTwinHexArray=MoveTemp(NegativeTwinHexArray);
+    
+    ReleaseGenerationData();
+}
+
+//Frees everything only the generation stages use; the per tile arrays shown to blueprints are kept
+//A tile store left by a loaded map goes too, so that a generation (even one skipping stages, see bIncrementalGeneration) never hands it over
+void AC_MapGenerator::ReleaseGenerationData() {
+    TileStore.Reset();
+    Lakes.Empty();
+    Rivers.Empty();
+    GenerationArena.Reset();
+    LandTiles.Empty();
+    WaterTiles.Empty();
+    LeftBankCount.Empty();
+    RightBankCount.Empty();
+    WaterBodyOfTile.Empty();
+    WaterBodySizes.Empty();
+    LakeOfTile.Empty();
+    Moisture.Empty();
+    StartRegionSeeds.Empty();
+    StartRegionOfTile.Empty();
+    StartSpotScores.Empty();
+}
+
+//Packs the generated per tile arrays into the tile store handed over to the game manager
+void AC_MapGenerator::PackTileStore() {
+    TileStore = MakeShareable(new FHexTileStore(mapsizex, mapsizey));
+    PackTileRecords(*TileStore);
+}
+
+void AC_MapGenerator::PackTileRecords(FHexTileStore& store) {
+    store.PackField(EHexTileField::Altitude, AltitudeMap);
+    store.PackField(EHexTileField::Terrain, TerrainType);
+    store.PackField(EHexTileField::Forest, Forests);
+    store.PackField(EHexTileField::FreshWater, freshWater);
+    store.PackField(EHexTileField::RiverEdges, RiverEdges);
+    store.PackField(EHexTileField::Resource, resources);
+    store.PackField(EHexTileField::Improvement, improvements);
+    if (initialCityDistricts.Num() == store.Num()) {//Otherwise there is no city yet, which is what a new store holds
+        store.PackField(EHexTileField::CityOwner, initialCityDistricts);
+    }
+    PackTwinFlags(store);
+}
+
+//Twin flags are only there once the hexes have been spawned
+void AC_MapGenerator::PackTwinFlags(FHexTileStore& store) {
+    if (hasPositiveTwin.Num() == store.Num()) {
+        store.PackField(EHexTileField::PositiveTwin, hasPositiveTwin);
+    }
+    if (hasNegativeTwin.Num() == store.Num()) {
+        store.PackField(EHexTileField::NegativeTwin, hasNegativeTwin);
+    }
+}
+
+//Checksum of everything besides the seed the generated map depends on
+uint32 AC_MapGenerator::GetGenerationParametersHash(int32 numberOfRivers) {
+    int32 parameters[] = {MapCacheVersion, mapsizex, mapsizey, MaxLakeSize, MaxFilledLakeSize, numberOfRivers, (int32)AltitudeMode, NoiseOctaves,
+        LongChainLength, MediumChainLength, ShortChainLength, TinyChainLength, (int32)ClimateMode, (int32)RiverMode, RiverDrainageTiles, (int32)ForestMode,
+        NumberOfCivs, StrategicResourcesPerRegion, LuxuryResourcesPerRegion, StartSpotRadius};
+    float floatParameters[] = {LongChainsPerThousandTiles, MediumChainsPerThousandTiles, ShortChainsPerThousandTiles, TinyChainsPerThousandTiles,
+        NoiseFeatureSize, LandShare, MidlandShare, HighlandShare, DesertMoisture, ForestDensity, StartSpotCandidateShare};
+    return FCrc::MemCrc32(floatParameters, sizeof(floatParameters), FCrc::MemCrc32(parameters, sizeof(parameters)));
 }
 
+//Name of the cached map : the seed, and the parameters checksum
+FString AC_MapGenerator::GetMapCacheKey(int32 numberOfRivers) {
+    return FString::Printf(TEXT("%d_%08x"), Seed, GetGenerationParametersHash(numberOfRivers));
+}
 
+FString AC_MapGenerator::GetMapCachePath(int32 numberOfRivers) {
+    return FPaths::GameSavedDir() + TEXT("MapCache/") + GetMapCacheKey(numberOfRivers) + TEXT(".world");
+}
 
+//Loads the output of all generation stages from the map cache; returns false if there is no usable cached map, in which case the map has to be generated
+bool AC_MapGenerator::LoadMapCache(int32 numberOfRivers) {
+    FWorldFile file;
+    if (!file.LoadFromFile(GetMapCachePath(numberOfRivers))) {
+        return false;
+    }
+    if ((file.GetHeader().Seed!=Seed) || (file.GetHeader().ParametersHash!=GetGenerationParametersHash(numberOfRivers)) || !ApplyWorldFile(file)) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("Unusable cached map %s, generating it again"), *GetMapCachePath(numberOfRivers));
+        return false;
+    }
+    return true;
+}
 
+bool AC_MapGenerator::SaveMapCache(int32 numberOfRivers) {
+    return WriteWorldFile(GetMapCachePath(numberOfRivers), GetGenerationParametersHash(numberOfRivers));
+}
 
+//Saves the generated map to a world file (see C_WorldFile.h)
+bool AC_MapGenerator::SaveWorld(const FString& path) {
+    return WriteWorldFile(path, 0);
+}
 
+//Loads a map saved with SaveWorld, in place of the generation; the hexes can then be spawned and the game manager initialized as usual
+bool AC_MapGenerator::LoadWorld(const FString& path) {
+    if (IsRefusedDuringGeneration(TEXT("LoadWorld"))) {
+        return false;
+    }
+    FWorldFile file;
+    return file.LoadFromFile(path) && ApplyWorldFile(file);
+}
 
+bool AC_MapGenerator::WriteWorldFile(const FString& path, uint32 parametersHash) {
+    FHexTileStore store(mapsizex, mapsizey);
+    PackTileRecords(store);
+    
+    //Lakes and river segments are flattened into one array each, plus the tiles and banks they reference
+    TArray<FWorldLake> lakes;
+    TArray<int32> lakeTiles;
+    for (int32 i=0; i<Lakes.Num(); i++) {
+        FWorldLake lake;
+        lake.FirstTile=lakeTiles.Num();
+        lake.NumTiles=Lakes[i]->tiles.Num();
+        lake.Altitude=Lakes[i]->altitude;
+        lake.Reserved=0;
+        lakes.Add(lake);
+        lakeTiles.Append(Lakes[i]->tiles);
+    }
+    TArray<FWorldRiverSegment> segments;
+    TArray<FWorldRiverBank> banks;
+    for (int32 i=0; i<Rivers.Num(); i++) {
+        FWorldRiverSegment segment;
+        segment.FirstBank=banks.Num();
+        segment.NumBanks=Rivers[i]->LeftBank.Num();
+        segment.Length=Rivers[i]->length;
+        segment.Altitude=Rivers[i]->segAltitude;
+        segment.Start=Rivers[i]->segStart;
+        segment.End=Rivers[i]->segEnd;
+        segments.Add(segment);
+        for (int32 j=0; j<Rivers[i]->LeftBank.Num(); j++) {
+            FWorldRiverBank bank;
+            bank.Left=Rivers[i]->LeftBank[j];
+            bank.Right=Rivers[i]->RightBank[j];
+            bank.Dir=Rivers[i]->dir[j];
+            banks.Add(bank);
+        }
+    }
+    
+    FWorldFileWriter writer(mapsizex, mapsizey, UsedSeed, parametersHash);
+    writer.AddSection(EWorldSection::TileRecords, store.GetRecords(), sizeof(uint32), store.Num());
+    writer.AddSection(EWorldSection::Altitude, AltitudeMap);
+    writer.AddSection(EWorldSection::Terrain, TerrainType);
+    writer.AddSection(EWorldSection::RiverEdges, RiverEdges);
+    writer.AddSection(EWorldSection::Forests, Forests);
+    writer.AddSection(EWorldSection::FreshWater, freshWater);
+    writer.AddSection(EWorldSection::Resources, resources);
+    writer.AddSection(EWorldSection::ResourceRotations, resourceRotations);
+    writer.AddSection(EWorldSection::Improvements, improvements);
+    writer.AddSection(EWorldSection::RampTypes, RampType);
+    writer.AddSection(EWorldSection::RampRotations, RampRotation);
+    writer.AddSection(EWorldSection::CoastTypes, CoastType);
+    writer.AddSection(EWorldSection::CoastRotations, CoastRotation);
+    writer.AddSection(EWorldSection::OceanCoastTypes, OceanCoastType);
+    writer.AddSection(EWorldSection::LandTiles, LandTiles);
+    writer.AddSection(EWorldSection::WaterTiles, WaterTiles);
+    writer.AddSection(EWorldSection::StartingSpots, StartingSpots);
+    writer.AddSection(EWorldSection::Lakes, lakes);
+    writer.AddSection(EWorldSection::LakeTiles, lakeTiles);
+    writer.AddSection(EWorldSection::RiverSegments, segments);
+    writer.AddSection(EWorldSection::RiverBanks, banks);
+    return writer.SaveToFile(path);
+}
 
+//Returns true if all values are tile indexes of the current map
+static bool AreTileIndexes(const int32* values, int32 count, int32 mapsize)
+{
+    for (int32 i=0; i<count; i++) {
+        if ((values[i]<0) || (values[i]>=mapsize)) {
+            return false;
+        }
+    }
+    return true;
+}
 
+//Takes over the content of a loaded world file : the tile store points into its buffer, everything else is copied section by section
+bool AC_MapGenerator::ApplyWorldFile(const FWorldFile& file) {
+    int32 sizex=file.GetHeader().mapsizex;
+    int32 sizey=file.GetHeader().mapsizey;
+    int32 mapsize=sizex*sizey;
+    
+    TSharedPtr<FHexTileStore> store=MakeShareable(new FHexTileStore());
+    int32 numberOfLakes=0;
+    int32 numberOfLakeTiles=0;
+    int32 numberOfSegments=0;
+    int32 numberOfBanks=0;
+    const FWorldLake* lakes=file.GetSectionData<FWorldLake>(EWorldSection::Lakes, numberOfLakes);
+    const int32* lakeTiles=file.GetSectionData<int32>(EWorldSection::LakeTiles, numberOfLakeTiles);
+    const FWorldRiverSegment* segments=file.GetSectionData<FWorldRiverSegment>(EWorldSection::RiverSegments, numberOfSegments);
+    const FWorldRiverBank* banks=file.GetSectionData<FWorldRiverBank>(EWorldSection::RiverBanks, numberOfBanks);
+    if (!store->AttachToBuffer(sizex, sizey, file.GetBuffer(), file.GetSectionOffset(EWorldSection::TileRecords))
+        || (lakes==nullptr) || (lakeTiles==nullptr) || (segments==nullptr) || (banks==nullptr)
+        || !AreTileIndexes(lakeTiles, numberOfLakeTiles, mapsize)) {
+        return false;
+    }
+    for (int32 i=0; i<numberOfLakes; i++) {
+        if ((lakes[i].FirstTile<0) || (lakes[i].NumTiles<0) || (lakes[i].FirstTile+lakes[i].NumTiles>numberOfLakeTiles)) {
+            return false;
+        }
+    }
+    for (int32 i=0; i<numberOfSegments; i++) {
+        if ((segments[i].FirstBank<0) || (segments[i].NumBanks<1) || (segments[i].FirstBank+segments[i].NumBanks>numberOfBanks)) {
+            return false;
+        }
+    }
+    for (int32 i=0; i<numberOfBanks; i++) {
+        if ((banks[i].Left<0) || (banks[i].Left>=mapsize) || (banks[i].Right<0) || (banks[i].Right>=mapsize)) {
+            return false;
+        }
+    }
+    
+    //Sections are read into locals first, so that a rejected file leaves the current map untouched
+    TArray<int32> altitudes, forests, fresh, rotations, rampTypes, rampRotations, coastTypes, coastRotations, oceanCoastTypes, landTiles, waterTiles, spots;
+    TArray<ETerrain> terrains;
+    TArray<uint8> riverEdges;
+    TArray<EResource> tileResources;
+    TArray<EImprovement> tileImprovements;
+    bool sectionsOk = file.CopySection(EWorldSection::Altitude, altitudes)
+    && file.CopySection(EWorldSection::Terrain, terrains)
+    && file.CopySection(EWorldSection::RiverEdges, riverEdges)
+    && file.CopySection(EWorldSection::Forests, forests)
+    && file.CopySection(EWorldSection::FreshWater, fresh)
+    && file.CopySection(EWorldSection::Resources, tileResources)
+    && file.CopySection(EWorldSection::ResourceRotations, rotations)
+    && file.CopySection(EWorldSection::Improvements, tileImprovements)
+    && file.CopySection(EWorldSection::RampTypes, rampTypes)
+    && file.CopySection(EWorldSection::RampRotations, rampRotations)
+    && file.CopySection(EWorldSection::CoastTypes, coastTypes)
+    && file.CopySection(EWorldSection::CoastRotations, coastRotations)
+    && file.CopySection(EWorldSection::OceanCoastTypes, oceanCoastTypes)
+    && file.CopySection(EWorldSection::LandTiles, landTiles)
+    && file.CopySection(EWorldSection::WaterTiles, waterTiles)
+    && file.CopySection(EWorldSection::StartingSpots, spots);
+    //Every per tile section has one value per tile
+    int32 perTileSizes[] = {altitudes.Num(), terrains.Num(), riverEdges.Num(), forests.Num(), fresh.Num(), tileResources.Num(), rotations.Num(), tileImprovements.Num(),
+        rampTypes.Num(), rampRotations.Num(), coastTypes.Num(), coastRotations.Num(), oceanCoastTypes.Num()};
+    for (int32 i=0; sectionsOk && (i<ARRAY_COUNT(perTileSizes)); i++) {
+        sectionsOk=(perTileSizes[i]==mapsize);
+    }
+    if (!sectionsOk || !AreTileIndexes(landTiles.GetData(), landTiles.Num(), mapsize) || !AreTileIndexes(waterTiles.GetData(), waterTiles.Num(), mapsize)
+        || !AreTileIndexes(spots.GetData(), spots.Num(), mapsize)) {
+        return false;
+    }
+    
+    AltitudeMap=MoveTemp(altitudes);
+    TerrainType=MoveTemp(terrains);
+    RiverEdges=MoveTemp(riverEdges);
+    Forests=MoveTemp(forests);
+    freshWater=MoveTemp(fresh);
+    resources=MoveTemp(tileResources);
+    resourceRotations=MoveTemp(rotations);
+    improvements=MoveTemp(tileImprovements);
+    RampType=MoveTemp(rampTypes);
+    RampRotation=MoveTemp(rampRotations);
+    CoastType=MoveTemp(coastTypes);
+    CoastRotation=MoveTemp(coastRotations);
+    OceanCoastType=MoveTemp(oceanCoastTypes);
+    LandTiles=MoveTemp(landTiles);
+    WaterTiles=MoveTemp(waterTiles);
+    StartingSpots=MoveTemp(spots);
+    mapsizex=sizex;
+    mapsizey=sizey;
+    UsedSeed=file.GetHeader().Seed;
+    BuildNeighborTable();
+    BuildDistanceFields();
+    TileStore=store;
+    //The snapshots are of another map now
+    StageSnapshots.Empty();
+    
+    Lakes.Empty();
+    Rivers.Empty();
+    GenerationArena.Reset();
+    LakeOfTile.Init(-1, mapsize);
+    for (int32 i=0; i<numberOfLakes; i++) {
+        WaterBody *lake = GenerationArena.New<WaterBody>();
+        lake->altitude=lakes[i].Altitude;
+        lake->tiles=TArray<int32>(lakeTiles+lakes[i].FirstTile, lakes[i].NumTiles);
+        for (int32 j=0; j<lake->tiles.Num(); j++) {
+            LakeOfTile[lake->tiles[j]]=i;
+        }
+        Lakes.Push(lake);
+    }
+    
+    for (int32 i=0; i<numberOfSegments; i++) {
+        const FWorldRiverBank* segmentBanks=banks+segments[i].FirstBank;
+        RiverSegment *segment = GenerationArena.New<RiverSegment>(segmentBanks[0].Left, segmentBanks[0].Right, segmentBanks[0].Dir, segments[i].Start);
+        for (int32 j=1; j<segments[i].NumBanks; j++) {
+            segment->LeftBank.Push(segmentBanks[j].Left);
+            segment->RightBank.Push(segmentBanks[j].Right);
+            segment->dir.Push(segmentBanks[j].Dir);
+        }
+        segment->length=segments[i].Length;
+        segment->segAltitude=segments[i].Altitude;
+        segment->segEnd=segments[i].End;
+        Rivers.Push(segment);
+    }
+    return true;
+}
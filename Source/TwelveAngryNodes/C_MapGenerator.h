@@ -4,8 +4,145 @@
 
 #include "GameFramework/Actor.h"
 #include "C_GameManager.h"
+#include "C_MapGenerationWorker.h"
+#include "C_MapRandom.h"
+#include "C_MapArena.h"
 #include "C_MapGenerator.generated.h"
 
+class FWorldFile;
+
+//Called on the game thread once GenerateMapAsync is done; bLoadedFromCache is true if the map came from the map cache
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMapGeneratedDelegate, bool, bLoadedFromCache);
+//Called on the game thread once a cancelled GenerateMapAsync has stopped
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FMapGenerationCancelledDelegate);
+
+//How GenerateAltitudeMap builds the altitudes
+UENUM(BlueprintType)
+enum class EAltitudeMode : uint8
+{
+    VE_Chains       UMETA(DisplayName="Chains"),   //Random walks elevating the tiles they go through
+    VE_Noise        UMETA(DisplayName="Noise")     //Fractal noise, cut into altitude levels by target shares of the map
+};
+
+//How BuildRivers lays the rivers out
+UENUM(BlueprintType)
+enum class ERiverMode : uint8
+{
+    VE_Walks        UMETA(DisplayName="Random Walks"),    //Rivers walking up from the coast, turning and forking at random
+    VE_Flow         UMETA(DisplayName="Flow")             //Rivers where the rain drained down the slopes gathers, up to numberOfRivers river mouths
+};
+
+//How GenerateDeserts places the deserts
+UENUM(BlueprintType)
+enum class EClimateMode : uint8
+{
+    VE_Seeds        UMETA(DisplayName="Desert Seeds"),    //Random walks from seeds away from water
+    VE_Moisture     UMETA(DisplayName="Moisture")         //Prevailing winds carrying moisture along the rows, with rain shadows behind heights
+};
+
+//How PlaceForests places the forests
+UENUM(BlueprintType)
+enum class EForestMode : uint8
+{
+    VE_CoinFlip     UMETA(DisplayName="Coin Flip"),     //Every land tile draws on its own, with a chance falling with the latitude
+    VE_BlueNoise    UMETA(DisplayName="Blue Noise")     //Forests spread out evenly, more or less tightly depending on the latitude and the moisture
+};
+
+//Distance fields of the generator : hops from every tile to the closest tile of a kind
+UENUM(BlueprintType)
+enum class EMapDistance : uint8
+{
+    VE_Water        UMETA(DisplayName="Water"),    //Ocean, coast and lake tiles
+    VE_Ocean        UMETA(DisplayName="Ocean"),    //Salt water : ocean and coast tiles
+    VE_Lake         UMETA(DisplayName="Lake"),
+    VE_River        UMETA(DisplayName="River"),    //Tiles with a river on one of their sides
+    VE_Land         UMETA(DisplayName="Land")      //For water tiles, how far out at sea they are
+};
+static const int32 NumberOfMapDistances = 5;
+
+//What a map has to meet to be kept by SearchSeeds
+USTRUCT(BlueprintType)
+struct FMapSeedConstraints
+{
+    GENERATED_USTRUCT_BODY()
+    
+    //Share of the tiles which are land, checked right after the terrain stage
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float MinLandShare;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float MaxLandShare;
+    //Rivers flowing into the sea or a lake, checked right after the river stage
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    int32 MinRivers;
+    //Score of the worst starting spot over the score of the best one (see GetStartingSpots)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float MinStartFairness;
+    //Land tiles of the landmass of every starting spot, so that no civ starts on its own on a small island
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    int32 MinStartLandmass;
+    
+    FMapSeedConstraints()
+    {
+        MinLandShare=0.1f;
+        MaxLandShare=0.5f;
+        MinRivers=1;
+        MinStartFairness=0.6f;
+        MinStartLandmass=40;
+    }
+};
+
+//A seed kept by SearchSeeds, along with what its map was checked on
+USTRUCT(BlueprintType)
+struct FMapSeedResult
+{
+    GENERATED_USTRUCT_BODY()
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    int32 Seed;
+    //Higher is better
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float Score;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float LandShare;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    int32 Rivers;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    float StartFairness;
+    
+    FMapSeedResult()
+    {
+        Seed=0;
+        Score=0.f;
+        LandShare=0.f;
+        Rivers=0;
+        StartFairness=0.f;
+    }
+};
+
+//Thumbnail of a map made by GeneratePreviews : altitudes, terrain and rivers only
+USTRUCT(BlueprintType)
+struct FMapPreview
+{
+    GENERATED_USTRUCT_BODY()
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Preview")
+    int32 Seed;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Preview")
+    int32 Width;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Preview")
+    int32 Height;
+    //Width*Height pixels, row by row from the top (north) of the map; FColor is laid out as the B8G8R8A8 texture of CreatePreviewTexture
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Preview")
+    TArray<FColor> Pixels;
+    
+    FMapPreview()
+    {
+        Seed=0;
+        Width=0;
+        Height=0;
+    }
+};
+
 /**
  * 
  */
@@ -31,12 +168,66 @@ struct RiverSegment {
     int32 segStart;
     int32 segEnd;
     
+    bool removed;//Taken out of the Rivers array while building
+    
     RiverSegment(int32 left, int32 right, int32 direction, int32 start){
         LeftBank.Push(left);
         RightBank.Push(right);
         dir.Push(direction);
         segStart=start;
         length=1;
+        removed=false;
+    }
+};
+
+//State of a river segment waiting on the stack of BuildRiverSegment
+struct RiverBuildFrame {
+    RiverSegment *segment;
+    int32 startLeft;
+    int32 startRight;
+    int32 resumeAt;//0=growing, 1=waiting on its cascade/waterfall segment, 2=waiting on its right fork segment, 3=waiting on its left fork segment
+    bool rightForkOk;
+    //Start of the left fork segment, built after the right one
+    int32 forkLeft;
+    int32 forkRight;
+    int32 forkDir;
+    
+    RiverBuildFrame(){
+        segment=nullptr;
+        startLeft=-1;
+        startRight=-1;
+        resumeAt=0;
+        rightForkOk=false;
+        forkLeft=-1;
+        forkRight=-1;
+        forkDir=0;
+    }
+    
+    RiverBuildFrame(RiverSegment *seg, int32 left, int32 right){
+        segment=seg;
+        startLeft=left;
+        startRight=right;
+        resumeAt=0;
+        rightForkOk=false;
+        forkLeft=-1;
+        forkRight=-1;
+        forkDir=0;
+    }
+};
+
+//Output of a generation stage, kept for incremental generation (see bIncrementalGeneration) : the arrays of the channels the stage writes, in the order
+//of ForEachChannelArray, and copies of the lakes or river segments if it writes them
+struct FMapStageSnapshot {
+    bool bValid;
+    //Parameters of the stage when it ran
+    uint32 ParametersHash;
+    TArray<TArray<uint8>> Arrays;
+    TArray<WaterBody> Lakes;
+    TArray<RiverSegment> Rivers;
+    
+    FMapStageSnapshot(){
+        bValid=false;
+        ParametersHash=0;
     }
 };
 
@@ -58,6 +249,106 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info", Meta=(ExposeOnSpawn=true))
     int32 mapsizey;
     
+    //Seed of the whole generation; 0 picks a new seed from the clock every time the map is generated
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info", Meta=(ExposeOnSpawn=true))
+    int32 Seed;
+    
+    //Seed actually used by the last generation (Seed, or the clock based one if Seed is 0); setting Seed to it gives the same map again
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Map Info")
+    int32 UsedSeed;
+    
+    //When true, GenerateMap saves generated maps to Saved/MapCache and loads them back instead of generating them again; only maps with an explicit Seed are cached
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
+    bool bUseMapCache;
+    
+    //When true, the output of every generation stage is kept, and GenerateMap only runs the stages from the first one whose parameters changed since the last
+    //generation, starting from what the stages before it left; tuning rivers or resources then only reruns the last stages. Only with an explicit Seed
+    //The kept output costs about as much memory as the generation data, once more per stage writing it
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
+    bool bIncrementalGeneration;
+    
+    //Biggest water body (in tiles) that can become a lake; bigger ones stay salt water
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info", Meta=(ExposeOnSpawn=true))
+    int32 MaxLakeSize;
+    //Biggest lake (in tiles) that can be filled up, with a chance of (size+1)/(MaxFilledLakeSize+1); bigger lakes, up to MaxLakeSize, are always kept
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info", Meta=(ExposeOnSpawn=true))
+    int32 MaxFilledLakeSize;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    EAltitudeMode AltitudeMode;
+    
+    //Altitude chains : random walks elevating every tile they go through, in four classes of lengths. Chain counts are given per 1000 tiles, so that maps of any size get the same share of land
+    //A chain of length L takes between L/2 and 3L/2 steps
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float LongChainsPerThousandTiles;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    int32 LongChainLength;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float MediumChainsPerThousandTiles;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    int32 MediumChainLength;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float ShortChainsPerThousandTiles;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    int32 ShortChainLength;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float TinyChainsPerThousandTiles;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    int32 TinyChainLength;
+    
+    //Noise mode : size of the biggest landmasses in tiles, and number of octaves (each one adds features half the size of the previous one)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float NoiseFeatureSize;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    int32 NoiseOctaves;
+    
+    //Noise mode : share of the map above water, at midland altitude or higher, and at highland altitude
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float LandShare;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float MidlandShare;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Altitude Generation")
+    float HighlandShare;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="River Generation")
+    ERiverMode RiverMode;
+    
+    //Flow mode : land a river drains at the very least, in tiles; rivers only go up as far as they drain that much, and smaller streams are left out
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="River Generation")
+    int32 RiverDrainageTiles;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Climate Generation")
+    EClimateMode ClimateMode;
+    
+    //Moisture mode : land below this moisture becomes desert, and grassland below twice this moisture becomes plain. A lowland coast at the equator has a moisture of about 1
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Climate Generation")
+    float DesertMoisture;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Forest Generation")
+    EForestMode ForestMode;
+    
+    //Blue noise mode : scales the share of forest wanted on every tile. At 1, wet lowlands near the equator are all forest, and forests thin out towards the poles
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Forest Generation")
+    float ForestDensity;
+    
+    //Number of civs, each getting a starting spot and the start region around it; every region gets at least the given number of strategic and luxury resources
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Resource Generation")
+    int32 NumberOfCivs;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Resource Generation")
+    int32 StrategicResourcesPerRegion;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Resource Generation")
+    int32 LuxuryResourcesPerRegion;
+    
+    //Starting spots are scored on the tiles up to this many hops away, and picked among the best scoring share of the land tiles
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Start Generation")
+    int32 StartSpotRadius;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Start Generation")
+    float StartSpotCandidateShare;
+    
+    //Maps kept by SearchSeeds
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Seed Search")
+    FMapSeedConstraints SeedConstraints;
+    
     //Possible values : 0, 1, 2, 3. At the end of GenerateTerrainType(), all non zero values get a -1, so that possible values are 0, 1->0, 2->1, 3->2.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
     TArray<int32> AltitudeMap;
@@ -73,19 +364,9 @@ public:
     TArray<int32> WaterTiles;
     
     
-    //Stocking river info for pathfinding
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn1;//right
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn2;//topright
+    //Stocking river info for pathfinding : bit dir-1 is set when there is a river between the tile and its 'dir' neighbor (1=right, 2=topright, 3=topleft, 4=left, 5=botleft, 6=botright)
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn3;//topleft
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn4;//left
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn5;//botleft
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
-    TArray<int32> RiverOn6;//botright
+    TArray<uint8> RiverEdges;
     
     /*Types are : 
       0=000000
@@ -141,7 +422,7 @@ public:
     TArray<EImprovement> improvements;
 
     
-    //Array of decent starting spots for civs; may contain more spots than there are civs, but not the contrary
+    //Starting spots for civs, NumberOfCivs of them (less only if there are not enough land tiles)
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
     TArray<int32> StartingSpots;
     
@@ -161,11 +442,45 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Manager Reference", Meta=(ExposeOnSpawn=true))
     AC_GameManager* manager;
     
+    UPROPERTY(BlueprintAssignable, Category="Map Generation Events")
+    FMapGeneratedDelegate OnMapGenerated;
+    UPROPERTY(BlueprintAssignable, Category="Map Generation Events")
+    FMapGenerationCancelledDelegate OnMapGenerationCancelled;
+    
     //Internal variables
     
-    FRandomStream randomstream;
+    //Draws of the river being built; rivers are built one after the other, as every river changes where the next ones can go
+    FMapRandomStream RiverRandom;
+    TSharedPtr<FHexNeighborTable> NeighborTable;
+    //Packed in InitializeGameManager, or loaded with a world file
+    TSharedPtr<FHexTileStore> TileStore;
+    //Pipeline of the last (or running) generation, kept for its stage timings
+    TSharedPtr<FMapGenerationPipeline> GenerationPipeline;
+    //Thread running GenerateMapAsync, until its completion reaches the game thread
+    TSharedPtr<FMapGenerationWorker> GenerationWorker;
+    //Owns the lakes and river segments, including the ones dropped while generating; reset by ReleaseGenerationData
+    FMapGenerationArena GenerationArena;
     TArray<WaterBody*> Lakes;
     TArray<RiverSegment*> Rivers;
+    //Number of placed river segment banks on each tile, for both sides
+    TArray<int32> LeftBankCount;
+    TArray<int32> RightBankCount;
+    //See EMapDistance; built once the rivers are there, and kept along with the per tile arrays
+    TArray<int32> DistanceFields[NumberOfMapDistances];
+    //Seed tile of every start region (its starting spot), and start region of every tile, as split by BuildStartRegions
+    TArray<int32> StartRegionSeeds;
+    TArray<int32> StartRegionOfTile;
+    //Score of every starting spot, as picked by GetStartingSpots
+    TArray<int32> StartSpotScores;
+    //Output of every stage of the last generation, when bIncrementalGeneration is set
+    TArray<FMapStageSnapshot> StageSnapshots;
+    //Rain brought by the winds on every tile, built by the moisture mode of GenerateDeserts (see DesertMoisture)
+    TArray<float> Moisture;
+    //Water body of each tile (-1 for land) and tile count of each body, as labeled by LabelWaterBodies
+    TArray<int32> WaterBodyOfTile;
+    TArray<int32> WaterBodySizes;
+    //Index in Lakes of each tile (-1 if not a lake)
+    TArray<int32> LakeOfTile;
     
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map Info")
     TArray<int32> initialCityDistricts;
@@ -174,6 +489,63 @@ public:
     
     AC_MapGenerator(const FObjectInitializer& ObjectInitializer);
     
+    //Runs every stage from GenerateAltitudeMap to GetStartingSpots, or loads their output from the map cache; returns true on a cache hit
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    bool GenerateMap(int32 numberOfRivers);
+    //Same as GenerateMap, but on a worker thread (the stages overlapping on the task graph when they don't share data), so the game thread never waits
+    //OnMapGenerated is broadcast on the game thread once done, or OnMapGenerationCancelled after CancelMapGeneration; returns false if a generation is already running
+    //The generator data must not be touched until then
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    bool GenerateMapAsync(int32 numberOfRivers);
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    void CancelMapGeneration();
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    bool IsGeneratingMap();
+    bool IsRefusedDuringGeneration(const TCHAR* functionName);
+    //Progress of the running generation for loading screens : share of the stages done (0 to 1) and name of the current stage
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    float GetGenerationProgress();
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    FString GetGenerationStage();
+    //Wall time of every stage of the last generation
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    FString GetGenerationTimingsReport();
+    void OnGenerationWorkerDone(int32 numberOfRivers, bool completed);
+    virtual void BeginDestroy() override;
+    TSharedPtr<FMapGenerationPipeline> BuildGenerationPipeline(int32 numberOfRivers);
+    void FinishGeneration(int32 numberOfRivers);
+    
+    //Headless batch generation : generates the maps of numberOfCandidates seeds from firstSeed on (skipping 0, the time based seed), with the parameters of this generator, several at once
+    //(one generator per worker), dropping every map which doesn't meet SeedConstraints; returns up to numberOfResults of the kept seeds, best first
+    //Maps are dropped as soon as a constraint fails, so most of the rejected seeds cost only the first stages
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    TArray<FMapSeedResult> SearchSeeds(int32 firstSeed, int32 numberOfCandidates, int32 numberOfResults, int32 numberOfRivers);
+    bool EvaluateSeed(int32 numberOfRivers, FMapSeedResult& outResult);
+    //Runs function on every index below count, spread over copies of this generator, see C_MapSeedSearch.cpp
+    int32 ForEachSeedOnWorkers(int32 count, TFunction<void(AC_MapGenerator*, int32)> function);
+    //Spawns a transient generator in 'world', with the properties of 'settings' when given; the caller destroys it once done
+    static AC_MapGenerator* SpawnTransientGenerator(UWorld* world, const AC_MapGenerator* settings);
+    int32 CountRiverMouths();
+    
+    //Seed browser : low resolution previews of the maps of the given seeds, with the parameters of this generator, several at once (one generator per worker, as SearchSeeds)
+    //Only the stages up to the rivers run, and nothing is spawned; a seed of 0 (time based) gets an empty preview
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    TArray<FMapPreview> GeneratePreviews(const TArray<int32>& seeds, int32 numberOfRivers, int32 width, int32 height);
+    void GeneratePreview(int32 numberOfRivers, int32 width, int32 height, FMapPreview& outPreview);
+    //Draws the per tile arrays as the river stage leaves them into width*height pixels; only reads its arguments, so it can be checked headless on hand made maps
+    static void RasterizePreview(int32 sizex, int32 sizey, const TArray<int32>& altitudes, const TArray<ETerrain>& terrains, const TArray<uint8>& riverEdges,
+                                 int32 width, int32 height, TArray<FColor>& outPixels);
+    //Transient texture showing a preview, for the UI; game thread only
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    static UTexture2D* CreatePreviewTexture(const FMapPreview& preview);
+    
+    //Incremental generation (see bIncrementalGeneration)
+    void PrepareIncrementalGeneration(FMapGenerationPipeline& pipeline);
+    void SaveStageSnapshot(const FMapGenerationStage& stage);
+    void RestoreStageSnapshots(const TArray<FMapGenerationStage>& stages, int32 firstStage);
+    template<typename FunctionType>
+    void ForEachChannelArray(EMapChannel channels, FunctionType function);
+    
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void GenerateAltitudeMap();
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
@@ -187,6 +559,8 @@ public:
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void GenerateTerrainType();
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    void BuildDistanceFields();
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void GenerateDeserts();
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void GetHexTypesAndRotations();
@@ -201,10 +575,35 @@ public:
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void GetStartingSpots();
     UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    void BuildStartRegions();
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    void PlaceResourceQuotas();
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
     void InitializeGameManager();
+    void ReleaseGenerationData();
+    void PackTileStore();
+    void PackTileRecords(FHexTileStore& store);
+    void PackTwinFlags(FHexTileStore& store);
+    
+    //World files (see C_WorldFile.h) : a generated map can be saved, then loaded instead of generated
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    bool SaveWorld(const FString& path);
+    UFUNCTION(BluePrintCallable, Category="Map Generation Functions")
+    bool LoadWorld(const FString& path);
+    bool WriteWorldFile(const FString& path, uint32 parametersHash);
+    bool ApplyWorldFile(const FWorldFile& file);
     
     //River utility functions to access what is inside the "Rivers" array
     UFUNCTION(BluePrintCallable, Category="River Utility Functions")
+    bool IsRiverOn(int32 index, int32 dir);
+    UFUNCTION(BluePrintCallable, Category="River Utility Functions")
+    bool IsNextToRiver(int32 index);
+    UFUNCTION(BluePrintCallable, Category="River Utility Functions")
+    TArray<int32> getRiverOnArray(int32 dir);
+    //Adds or removes the river between a tile and its 'dir' neighbor; both sides of the edge are updated
+    UFUNCTION(BluePrintCallable, Category="River Utility Functions")
+    void SetRiverOn(int32 index, int32 dir, bool bRiver);
+    UFUNCTION(BluePrintCallable, Category="River Utility Functions")
     int32 getTotalNumberOfRiverSegments();
     UFUNCTION(BluePrintCallable, Category="River Utility Functions")
     TArray<int32> getLeftBankArray(int32 i);
@@ -228,19 +627,70 @@ public:
     UFUNCTION(BluePrintCallable, Category="Access Functions")
     int32 getNeighbor(int32 index, int32 dir);
     
-    int32 getNeighbor(int32 x, int32 y, int32 dir);
+    //Number of hops from tile 'index' to the closest tile of the field's kind, 0 if the tile is of that kind; -1 if there is none, or if the distance fields aren't built yet
+    UFUNCTION(BluePrintCallable, Category="Access Functions")
+    int32 GetDistance(EMapDistance field, int32 index);
+    
+    const TArray<int32>& GetDistanceField(EMapDistance field) const
+    {
+        return DistanceFields[(int32)field];
+    }
+    
+    void BuildNeighborTable();
+    void InitializeSeed();
+    
+    //The two altitude modes of GenerateAltitudeMap (see AltitudeMode)
+    void GenerateChainAltitudes();
+    void GenerateNoiseAltitudes();
+    
+    //The two modes of BuildRivers (see RiverMode)
+    void BuildRandomWalkRivers(int32 numberOfRivers);
+    void BuildFlowRivers(int32 numberOfRivers);
+    
+    //The two modes of GenerateDeserts (see ClimateMode)
+    void GenerateSeededDeserts();
+    void GenerateClimateDeserts();
+    void ComputeMoistureRow(int32 y);
+    
+    //The two modes of PlaceForests (see ForestMode)
+    void PlaceCoinFlipForests();
+    void PlaceBlueNoiseForests();
+    
+    EResource PickResource(int32 tile, EImprovement family, uint8 kind, FMapRandomStream& random);
+    
+    //Draws of 'key' (a tile, a chain...) for a generation stage; see FMapRandom
+    FORCEINLINE FMapRandomStream GetRandomStream(EMapRandomStage stage, int32 key) const
+    {
+        return FMapRandomStream(UsedSeed, stage, key);
+    }
+    
+    //Map cache : generated maps are saved as world files, named after the seed and every parameter the generation depends on
+    uint32 GetGenerationParametersHash(int32 numberOfRivers);
+    FString GetMapCacheKey(int32 numberOfRivers);
+    FString GetMapCachePath(int32 numberOfRivers);
+    bool LoadMapCache(int32 numberOfRivers);
+    bool SaveMapCache(int32 numberOfRivers);
     
-    bool CheckIfLake(int32 start, WaterBody *lake);
+    void LabelWaterBodies();
     int32 CheckIfLakeTile(int32 i);
     bool CheckIfOcean(int32 i);
+    void ComputeOceanTiles(TArray<uint8>& outOcean);
     
     bool BuildRiverSegment(int32 startLeft, int32 startRight, int32 startDir, int initstate, bool waterStart, int32 waterStartAltitude);
     bool CheckifAlreadyInLeftBank(int32 i);
     bool CheckifAlreadyInRightBank(int32 i);
+    void PushRiverBanks(RiverSegment *seg, int32 left, int32 right, int32 direction);
+    void RemoveLastRiverSegment();
+    RiverBuildFrame BeginRiverSegment(int32 startLeft, int32 startRight, int32 startDir, int32 initstate, bool waterStart, int32 waterStartAltitude);
+    int32 GrowRiverSegment(RiverBuildFrame &frame, bool childResult, RiverBuildFrame &started);
+    bool CheckIfRiverCanTurn(int32 next, int32 bankLast, int32 goingTowards, bool rightSide);
+    int32 TurnRiverSegment(RiverSegment *actualSeg, int32 goingTowards, bool rightTurn);
     bool CheckIfEligibleRiverStart(int32 i, int32 dir);
     bool CheckIfEligibleRiverLakeStart(int32 i, int32 dir, int32 lake);
     bool CheckIfTileIsNextToWater(int32 index);
     int32 getApparentLatitude(int32 index);
+    int32 getSiteValue(int32 index);
+    void ScoreStartSites(TArray<int32>& outScores);
     int32 getLatitude(int32 index);
     int32 getSnowWeight(int32 latitude);
     int32 getTundraWeight(int32 latitude);
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapNoise.h"
+
+FHexCylinderNoise::FHexCylinderNoise(int32 inMapsizex, int32 inSeed, float featureSize, int32 inOctaves)
+: mapsizex(inMapsizex), Seed((uint32)inSeed), Frequency(1.f/FMath::Max(featureSize, 1.f)), Octaves(FMath::Max(inOctaves, 1))
+{
+    //A step of one tile is as long around the cylinder as it is along it
+    float radius=mapsizex/(2.f*PI);
+    CircleX.SetNum(2*mapsizex);
+    CircleY.SetNum(2*mapsizex);
+    for (int32 i=0; i<2*mapsizex; i++) {
+        float angle=PI*i/mapsizex;
+        CircleX[i]=radius*FMath::Cos(angle);
+        CircleY[i]=radius*FMath::Sin(angle);
+    }
+}
+
+//Hash of a lattice point, with integer operations only
+static FORCEINLINE uint32 HashLattice(int32 x, int32 y, int32 z, uint32 seed)
+{
+    uint32 hash=seed ^ ((uint32)x*0x8DA6B343u) ^ ((uint32)y*0xD8163841u) ^ ((uint32)z*0xCB1AB31Fu);
+    hash^=hash >> 15;
+    hash*=0x2C1B3C6Du;
+    hash^=hash >> 12;
+    hash*=0x297A2D39u;
+    hash^=hash >> 15;
+    return hash;
+}
+
+//Dot product of the offset to a lattice point with one of the 12 Perlin gradients (16 with repeats) picked by the hash, with selects instead of a gradient table
+static FORCEINLINE float Gradient(uint32 hash, float x, float y, float z)
+{
+    uint32 h=hash & 15;
+    float u=(h < 8) ? x : y;
+    float v=(h < 4) ? y : (((h == 12) || (h == 14)) ? x : z);
+    return (((h & 1) != 0) ? -u : u) + (((h & 2) != 0) ? -v : v);
+}
+
+//Floor as an integer, without a library call : truncation, then one less for negative values with a fraction
+static FORCEINLINE int32 FloorToLattice(float value)
+{
+    int32 truncated=(int32)value;
+    return truncated - (value < (float)truncated ? 1 : 0);
+}
+
+static FORCEINLINE float Fade(float t)
+{
+    return t*t*t*(t*(t*6.f - 15.f) + 10.f);
+}
+
+//Adds amplitude times the 3D gradient noise (about [-1,1]) of the points (xs[i], ys[i], z) to values[i]
+static void AddGradientNoiseRow(const float* xs, const float* ys, float z, float amplitude, uint32 seed, float* values, int32 count)
+{
+    int32 iz=FloorToLattice(z);
+    float dz=z-iz;
+    float w=Fade(dz);
+    for (int32 i=0; i<count; i++) {
+        int32 ix=FloorToLattice(xs[i]);
+        int32 iy=FloorToLattice(ys[i]);
+        float dx=xs[i]-ix;
+        float dy=ys[i]-iy;
+        float u=Fade(dx);
+        float v=Fade(dy);
+
+        float n000=Gradient(HashLattice(ix, iy, iz, seed), dx, dy, dz);
+        float n100=Gradient(HashLattice(ix+1, iy, iz, seed), dx-1.f, dy, dz);
+        float n010=Gradient(HashLattice(ix, iy+1, iz, seed), dx, dy-1.f, dz);
+        float n110=Gradient(HashLattice(ix+1, iy+1, iz, seed), dx-1.f, dy-1.f, dz);
+        float n001=Gradient(HashLattice(ix, iy, iz+1, seed), dx, dy, dz-1.f);
+        float n101=Gradient(HashLattice(ix+1, iy, iz+1, seed), dx-1.f, dy, dz-1.f);
+        float n011=Gradient(HashLattice(ix, iy+1, iz+1, seed), dx, dy-1.f, dz-1.f);
+        float n111=Gradient(HashLattice(ix+1, iy+1, iz+1, seed), dx-1.f, dy-1.f, dz-1.f);
+
+        float nx00=n000 + u*(n100-n000);
+        float nx10=n010 + u*(n110-n010);
+        float nx01=n001 + u*(n101-n001);
+        float nx11=n011 + u*(n111-n011);
+        float nxy0=nx00 + v*(nx10-nx00);
+        float nxy1=nx01 + v*(nx11-nx01);
+        values[i]+=amplitude*(nxy0 + w*(nxy1-nxy0));
+    }
+}
+
+void FHexCylinderNoise::SampleRow(int32 y, float* values) const
+{
+    TArray<float> xs;
+    TArray<float> ys;
+    xs.SetNumUninitialized(mapsizex);
+    ys.SetNumUninitialized(mapsizex);
+    for (int32 x=0; x<mapsizex; x++) {
+        values[x]=0.f;
+    }
+
+    //Row y is shifted by half a tile from row y-1 : tile x is on half column 2x+y, around the cylinder
+    int32 rowShift=y % (2*mapsizex);
+    float py=y*0.8660254f;
+    float frequency=Frequency;
+    float amplitude=1.f;
+    for (int32 octave=0; octave<Octaves; octave++) {
+        for (int32 x=0; x<mapsizex; x++) {
+            int32 column=2*x + rowShift;
+            column=(column >= 2*mapsizex) ? column - 2*mapsizex : column;
+            xs[x]=CircleX[column]*frequency;
+            ys[x]=CircleY[column]*frequency;
+        }
+        AddGradientNoiseRow(xs.GetData(), ys.GetData(), py*frequency, amplitude, Seed + octave*0x9E3779B9u, values, mapsizex);
+        frequency*=2.f;
+        amplitude*=0.5f;
+    }
+}
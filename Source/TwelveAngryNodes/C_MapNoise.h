@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Fractal gradient noise over the hex map, used by the noise altitude mode of the map generator.
+ * Tiles are sampled at their real place on the hex lattice (px = x + y/2, py = y*sqrt(3)/2), with the map rolled into a cylinder : px is an angle
+ * around it, so that the 3D noise sampled on the cylinder is continuous across the x=0/mapsizex seam.
+ * Rows are sampled a whole row at a time : the positions around the cylinder come from a table of cosines and sines made once, and every octave runs one plain loop
+ * over the row, hashing the lattice corners with integer operations instead of a permutation table. Nothing is vectorized by hand.
+ */
+class TWELVEANGRYNODES_API FHexCylinderNoise
+{
+public:
+
+    //featureSize is the size of the biggest features, in tiles; every further octave has features half as big, weighing half as much
+    FHexCylinderNoise(int32 inMapsizex, int32 inSeed, float featureSize, int32 inOctaves);
+
+    //Writes the noise of every tile of row y (mapsizex values); rows don't depend on each other, so they can be sampled from any thread
+    void SampleRow(int32 y, float* values) const;
+
+private:
+
+    int32 mapsizex;
+    uint32 Seed;
+    float Frequency;
+    int32 Octaves;
+    //Point of every half tile column (2*px) on the section of the cylinder, which has a circumference of mapsizex
+    TArray<float> CircleX;
+    TArray<float> CircleY;
+};
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "Async/ParallelFor.h"
+#include "C_MapGenerator.h"
+
+/*
+ Map previews for the seed browser : only the altitude, lake, terrain and river stages run (no deserts, hex types, resources or starting spots), then the tiles are drawn into a small
+ CPU side image. Spawning hexes stays with the blueprint : the only actors previews spawn are their transient worker generators. The texture is made last, on the game thread.
+ */
+
+//Pixels at least this many tiles wide can't show which side of a tile a river runs along, so they are tinted as a whole
+static const float PreviewCoarsePixel = 1.f;
+static const FColor PreviewRiverColor(64, 128, 200);
+static const FColor PreviewMountainColor(120, 108, 96);
+
+static FColor PreviewTerrainColor(ETerrain terrain)
+{
+    switch (terrain) {
+        case ETerrain::VE_Ocean:
+            return FColor(24, 52, 108);
+        case ETerrain::VE_Coast:
+            return FColor(48, 100, 164);
+        case ETerrain::VE_Lake:
+            return FColor(56, 116, 184);
+        case ETerrain::VE_Marsh:
+            return FColor(84, 108, 72);
+        case ETerrain::VE_Grassland:
+            return FColor(92, 140, 60);
+        case ETerrain::VE_Plain:
+            return FColor(160, 152, 84);
+        case ETerrain::VE_Tundra:
+            return FColor(128, 124, 108);
+        case ETerrain::VE_Snow:
+            return FColor(232, 236, 240);
+        case ETerrain::VE_Desert:
+            return FColor(220, 196, 128);
+        default:
+            return FColor(0, 0, 0);
+    }
+}
+
+//Integer blend, so that previews are the same bytes on every platform
+static FColor BlendPreviewColor(const FColor& a, const FColor& b, int32 weightOfB)
+{
+    return FColor((uint8)((a.R*(256-weightOfB) + b.R*weightOfB) >> 8),
+                  (uint8)((a.G*(256-weightOfB) + b.G*weightOfB) >> 8),
+                  (uint8)((a.B*(256-weightOfB) + b.B*weightOfB) >> 8));
+}
+
+TArray<FMapPreview> AC_MapGenerator::GeneratePreviews(const TArray<int32>& seeds, int32 numberOfRivers, int32 width, int32 height)
+{
+    TArray<FMapPreview> previews;
+    double start=FPlatformTime::Seconds();
+    previews.SetNum(seeds.Num());
+    int32 numberOfWorkers=ForEachSeedOnWorkers(seeds.Num(), [&previews, &seeds, numberOfRivers, width, height](AC_MapGenerator* worker, int32 i) {
+        //Seed 0 would draw a time based map, not the one any seed gives : its preview is left empty
+        if (seeds[i] == 0) {
+            return;
+        }
+        worker->Seed=seeds[i];
+        worker->GeneratePreview(numberOfRivers, width, height, previews[i]);
+    });
+    if (numberOfWorkers == 0) {
+        previews.Empty();
+        return previews;
+    }
+
+    UE_LOG(LogMapGeneration, Log, TEXT("%d previews of %dx%d maps, %d workers, %.1f ms"),
+           seeds.Num(), mapsizex, mapsizey, numberOfWorkers, (FPlatformTime::Seconds()-start)*1000.);
+    return previews;
+}
+
+//Generates the map of Seed up to the rivers and draws it; the generation data is released afterwards, as by EvaluateSeed
+void AC_MapGenerator::GeneratePreview(int32 numberOfRivers, int32 width, int32 height, FMapPreview& outPreview)
+{
+    TSharedPtr<FMapGenerationPipeline> pipeline=BuildGenerationPipeline(numberOfRivers);
+    FMapGenerationPipeline* run=pipeline.Get();
+    pipeline->SetStageDoneCallback([run](const FMapGenerationStage& stage) {
+        if (stage.Name == TEXT("Rivers")) {
+            run->RequestCancel();
+        }
+    });
+    pipeline->Run();
+
+    outPreview.Seed=UsedSeed;
+    outPreview.Width=FMath::Max(width, 1);
+    outPreview.Height=FMath::Max(height, 1);
+    RasterizePreview(mapsizex, mapsizey, AltitudeMap, TerrainType, RiverEdges, outPreview.Width, outPreview.Height, outPreview.Pixels);
+    ReleaseGenerationData();
+}
+
+/*
+ Every pixel takes the tile under its center. Tile x of row y is centered half a tile right of tile x of row y-1 (its topright neighbor is x on the next row), so rows are
+ shifted by half a tile each and wrap around the cylinder. The pixel then picks the side of the tile it is closest to : rows are cut in three bands, the middle third
+ (where the left and right sides of a hex are) split between the left and right neighbors, the top and bottom ones between the two neighbors above or below, and pixels
+ along a side with a river are drawn as river.
+ Land is darker on hills (altitude 2) and blended to rock on mountains (altitude 3 and more), as the altitudes are before ReduceLandAltitude.
+ */
+void AC_MapGenerator::RasterizePreview(int32 sizex, int32 sizey, const TArray<int32>& altitudes, const TArray<ETerrain>& terrains, const TArray<uint8>& riverEdges,
+                                       int32 width, int32 height, TArray<FColor>& outPixels)
+{
+    outPixels.SetNumUninitialized(width*height);
+    float tilesPerPixel=(float)sizex/width;
+    float rowsPerPixel=(float)sizey/height;
+    bool bCoarse=(tilesPerPixel >= PreviewCoarsePixel);
+    for (int32 py=0; py<height; py++) {
+        //Map rows go up, image rows go down
+        float v=sizey - (py+0.5f)*rowsPerPixel;
+        int32 y=FMath::Clamp(FMath::FloorToInt(v), 0, sizey-1);
+        float dy=v - (y+0.5f);
+        for (int32 px=0; px<width; px++) {
+            float u=(px+0.5f)*tilesPerPixel - 0.5f*y;
+            int32 x=FMath::FloorToInt(u);
+            float dx=u - x - 0.5f;
+            x=((x % sizex) + sizex) % sizex;
+            int32 i=x + y*sizex;
+
+            FColor color=PreviewTerrainColor(terrains[i]);
+            bool bWater=(terrains[i] == ETerrain::VE_Ocean) || (terrains[i] == ETerrain::VE_Coast) || (terrains[i] == ETerrain::VE_Lake);
+            if (!bWater) {
+                if (altitudes[i] >= 3) {
+                    color=BlendPreviewColor(color, PreviewMountainColor, 160);
+                }
+                else if (altitudes[i] == 2) {
+                    color=BlendPreviewColor(color, FColor(0, 0, 0), 40);
+                }
+            }
+
+            if (riverEdges[i] != 0) {
+                if (bCoarse) {
+                    color=BlendPreviewColor(color, PreviewRiverColor, 128);
+                }
+                else {
+                    int32 dir;
+                    bool bNearSide;
+                    if (FMath::Abs(dy) < 1.f/6.f) {
+                        dir=(dx >= 0.f) ? 1 : 4;
+                        bNearSide=(FMath::Abs(dx) >= 0.25f);
+                    }
+                    else {
+                        dir=(dy > 0.f) ? ((dx >= 0.f) ? 2 : 3) : ((dx >= 0.f) ? 6 : 5);
+                        bNearSide=true;
+                    }
+                    if (bNearSide && ((riverEdges[i] & FHexNeighborTable::EdgeBit(dir)) != 0)) {
+                        color=PreviewRiverColor;
+                    }
+                }
+            }
+            outPixels[px + py*width]=color;
+        }
+    }
+}
+
+UTexture2D* AC_MapGenerator::CreatePreviewTexture(const FMapPreview& preview)
+{
+    if ((preview.Width <= 0) || (preview.Height <= 0) || (preview.Pixels.Num() != preview.Width*preview.Height)) {
+        return nullptr;
+    }
+    UTexture2D* texture=UTexture2D::CreateTransient(preview.Width, preview.Height, PF_B8G8R8A8);
+    if (texture == nullptr) {
+        return nullptr;
+    }
+    //Hexes stay sharp when the thumbnail is scaled up
+    texture->Filter=TF_Nearest;
+    void* data=texture->PlatformData->Mips[0].BulkData.Lock(LOCK_READ_WRITE);
+    FMemory::Memcpy(data, preview.Pixels.GetData(), preview.Pixels.Num()*sizeof(FColor));
+    texture->PlatformData->Mips[0].BulkData.Unlock();
+    texture->UpdateResource();
+    return texture;
+}
+
+
+static void PreviewSeedsOnDefaultMap(UWorld* world)
+{
+    AC_MapGenerator* generator=AC_MapGenerator::SpawnTransientGenerator(world, nullptr);
+    if (generator == nullptr) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("tan.PreviewSeeds needs a world to spawn its generators in"));
+        return;
+    }
+    generator->mapsizex=128;
+    generator->mapsizey=81;
+
+    TArray<int32> seeds;
+    for (int32 i=1; i<=12; i++) {
+        seeds.Add(i);
+    }
+    //Rows are 0.87 tile apart, so 2 pixels per tile across and 1.73 per row keep the hexes round
+    generator->GeneratePreviews(seeds, 40, 256, 140);
+    generator->Destroy();
+}
+
+static FAutoConsoleCommandWithWorld PreviewSeedsCommand(
+    TEXT("tan.PreviewSeeds"),
+    TEXT("Makes the 256x140 previews of the 128x81 maps of seeds 1 to 12 and logs how long it took"),
+    FConsoleCommandWithWorldDelegate::CreateStatic(&PreviewSeedsOnDefaultMap));
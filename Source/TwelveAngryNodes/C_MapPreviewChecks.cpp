@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_HexGrid.h"
+#include "C_MapGenerator.h"
+
+/*
+ Headless checks of the seed browser previews, run as the benchmarks :
+ UE4Editor-Cmd TwelveAngryNodes.uproject -game -nullrhi -ExecCmds="tan.CheckPreviewRaster,quit"
+ */
+
+//Expected images are written one character per pixel, top row first; every character stands for one of the colors of its legend
+struct FExpectedColor
+{
+    TCHAR Key;
+    FColor Color;
+};
+
+static bool ComparePreviewPixels(const TCHAR* name, const TArray<FColor>& pixels, int32 width, int32 height,
+                                 const TArray<FExpectedColor>& legend, const TArray<const TCHAR*>& rows)
+{
+    if ((rows.Num() != height) || (pixels.Num() != width*height)) {
+        UE_LOG(LogMapGeneration, Display, TEXT("Preview raster %s %dx%d : %d pixels (PIXELS DIFFER)"), name, width, height, pixels.Num());
+        return false;
+    }
+    for (int32 py=0; py<height; py++) {
+        for (int32 px=0; px<width; px++) {
+            FColor expected(0, 0, 0, 0);
+            for (const FExpectedColor& entry : legend) {
+                if (entry.Key == rows[py][px]) {
+                    expected=entry.Color;
+                }
+            }
+            const FColor& pixel=pixels[py*width+px];
+            if ((pixel.R != expected.R) || (pixel.G != expected.G) || (pixel.B != expected.B)) {
+                UE_LOG(LogMapGeneration, Display, TEXT("Preview raster %s %dx%d : pixel (%d, %d) is (%d, %d, %d), expected (%d, %d, %d) (PIXELS DIFFER)"),
+                       name, width, height, px, py, pixel.R, pixel.G, pixel.B, expected.R, expected.G, expected.B);
+                return false;
+            }
+        }
+    }
+    UE_LOG(LogMapGeneration, Display, TEXT("Preview raster %s %dx%d (pixels match)"), name, width, height);
+    return true;
+}
+
+//A 4x2 hand made map, covering the odd row offset, the hill and mountain shading, a river along two edges and the blend of the coarse pixels
+static void CheckPreviewRaster()
+{
+    const int32 sizex=4;
+    const int32 sizey=2;
+    TArray<ETerrain> terrains={ETerrain::VE_Ocean, ETerrain::VE_Grassland, ETerrain::VE_Grassland, ETerrain::VE_Desert,
+                               ETerrain::VE_Coast, ETerrain::VE_Plain, ETerrain::VE_Snow, ETerrain::VE_Lake};
+    TArray<int32> altitudes={0, 1, 2, 1,
+                             0, 3, 1, 2};
+    TArray<uint8> riverEdges;
+    riverEdges.SetNumZeroed(sizex*sizey);
+    FHexNeighborTable table(sizex, sizey);
+    table.SetEdge(riverEdges, 1, 1);
+    table.SetEdge(riverEdges, 1, 2);
+
+    //Two pixels per tile across and four per row : every tile is split in its six direction sectors
+    TArray<FColor> fine;
+    AC_MapGenerator::RasterizePreview(sizex, sizey, altitudes, terrains, riverEdges, 16, 8, fine);
+    TArray<FExpectedColor> fineLegend={{'a', FColor(24, 52, 108)}, {'b', FColor(48, 100, 164)}, {'c', FColor(56, 116, 184)},
+                                      {'d', FColor(64, 128, 200)}, {'e', FColor(77, 118, 50)}, {'f', FColor(92, 140, 60)},
+                                      {'g', FColor(135, 124, 91)}, {'h', FColor(220, 196, 128)}, {'i', FColor(232, 236, 240)}};
+    TArray<const TCHAR*> fineRows={TEXT("ccbbbbggggiiiicc"),
+                                   TEXT("ccbbbbggggiiiicc"),
+                                   TEXT("ccbbbbggggiiiicc"),
+                                   TEXT("ccbbbbddggiiiicc"),
+                                   TEXT("aaaaffddeeeehhhh"),
+                                   TEXT("aaaafffddeeehhhh"),
+                                   TEXT("aaaafffddeeehhhh"),
+                                   TEXT("aaaaffffeeeehhhh")};
+    bool fineMatch=ComparePreviewPixels(TEXT("fine"), fine, 16, 8, fineLegend, fineRows);
+
+    //One pixel per tile : rivers are blended into the tile color instead of drawn
+    TArray<FColor> coarse;
+    AC_MapGenerator::RasterizePreview(sizex, sizey, altitudes, terrains, riverEdges, 4, 2, coarse);
+    TArray<FExpectedColor> coarseLegend={{'a', FColor(24, 52, 108)}, {'b', FColor(48, 100, 164)}, {'c', FColor(56, 116, 184)},
+                                        {'d', FColor(70, 123, 125)}, {'e', FColor(78, 134, 130)}, {'f', FColor(99, 126, 145)},
+                                        {'g', FColor(220, 196, 128)}, {'h', FColor(232, 236, 240)}};
+    TArray<const TCHAR*> coarseRows={TEXT("bfhc"),
+                                     TEXT("aedg")};
+    bool coarseMatch=ComparePreviewPixels(TEXT("coarse"), coarse, 4, 2, coarseLegend, coarseRows);
+
+    UE_LOG(LogMapGeneration, Display, TEXT("Preview raster checks : %s"), (fineMatch && coarseMatch) ? TEXT("passed") : TEXT("FAILED"));
+}
+
+static FAutoConsoleCommand CheckPreviewRasterCommand(
+    TEXT("tan.CheckPreviewRaster"),
+    TEXT("Draws a small hand made map at two preview sizes and compares the pixels to the expected images"),
+    FConsoleCommandDelegate::CreateStatic(&CheckPreviewRaster));
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+//Map generation steps drawing random numbers; every step gets numbers of its own, so adding draws to one step doesn't change the others
+//Values of steps which no longer draw are kept reserved rather than reused, so that the other steps keep their numbers and old seeds give the same maps
+enum class EMapRandomStage : uint32
+{
+    AltitudeChains  = 1,    //Keyed on the chain
+    LongChains      = 2,    //Keyed on the tile
+    Lakes           = 3,    //Keyed on the first tile of the lake
+    Terrain         = 4,    //Keyed on the tile
+    RiverStarts     = 5,    //Single key, one draw per river
+    Rivers          = 6,    //Keyed on the start of the river, or on the tile corner for flow rivers
+    Deserts         = 7,    //Keyed on the desert seed tile
+    HexTypes        = 8,    //Keyed on the tile
+    Forests         = 9,    //Keyed on the tile
+    ResourceSpots   = 10,   //Keyed on the tile
+    Resources       = 11,   //Keyed on the resource tile
+    Reserved12      = 12,
+    ForestSampling  = 13,   //Single key, draws shuffling the land tiles for blue noise forests
+    Reserved14      = 14,
+    ResourceQuotas  = 15    //Keyed on the start region
+};
+
+/**
+ * Stateless counter based random numbers for the map generation.
+ * A number only depends on (seed, stage, key, draw) : the key is what the number is drawn for (a tile, a chain, a river...) and the draw counts the numbers
+ * already drawn for that key. There is no state shared between keys, so tiles can be done in any order and on any number of threads and still get
+ * the same numbers, which keeps generated maps identical whatever the core count.
+ */
+struct FMapRandom
+{
+    //SplitMix64 finalizer
+    static FORCEINLINE uint64 Mix(uint64 value)
+    {
+        value+=0x9E3779B97F4A7C15ull;
+        value=(value ^ (value >> 30))*0xBF58476D1CE4E5B9ull;
+        value=(value ^ (value >> 27))*0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    static FORCEINLINE uint32 Hash(int32 seed, EMapRandomStage stage, int32 key, int32 draw)
+    {
+        uint64 value=Mix(((uint64)(uint32)stage << 32) | (uint32)seed);
+        value=Mix(value ^ (((uint64)(uint32)draw << 32) | (uint32)key));
+        return (uint32)(value >> 32);
+    }
+
+    //Integer in [min,max], both included, as FRandomStream::RandRange; returns min if max<min
+    static FORCEINLINE int32 RandRange(int32 seed, EMapRandomStage stage, int32 key, int32 draw, int32 min, int32 max)
+    {
+        int64 range=(int64)max - min + 1;
+        if (range <= 0) {
+            return min;
+        }
+        return min + (int32)(((uint64)Hash(seed, stage, key, draw)*(uint64)range) >> 32);
+    }
+};
+
+/**
+ * Successive draws of one key : a handy way to take several numbers for the same tile (or chain, river...).
+ * Cheap to create, meant to live on the stack of whatever works on the key; two streams of the same key give the same numbers.
+ */
+struct FMapRandomStream
+{
+    FMapRandomStream() : Seed(0), Stage(EMapRandomStage::AltitudeChains), Key(0), Draw(0) {}
+    FMapRandomStream(int32 inSeed, EMapRandomStage inStage, int32 inKey) : Seed(inSeed), Stage(inStage), Key(inKey), Draw(0) {}
+
+    FORCEINLINE int32 RandRange(int32 min, int32 max)
+    {
+        return FMapRandom::RandRange(Seed, Stage, Key, Draw++, min, max);
+    }
+
+    int32 Seed;
+    EMapRandomStage Stage;
+    int32 Key;
+    int32 Draw;
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapSampler.h"
+
+FHexBlueNoiseSampler::FHexBlueNoiseSampler(int32 inMapsizex, int32 inMapsizey, float maxSpacing)
+: mapsizex(inMapsizex), mapsizey(inMapsizey), MaxSpacing(maxSpacing)
+{
+    //A bucket is at least 2*MaxSpacing half columns wide, and rows are sqrt(3)/2 apart
+    int32 bucketWidth=FMath::Max(FMath::CeilToInt(2.f*MaxSpacing), 1);
+    BucketColumns=FMath::Max(2*mapsizex/bucketWidth, 1);
+    RowsPerBucket=FMath::Max(FMath::CeilToInt(MaxSpacing/0.8660254f), 1);
+    BucketRows=(mapsizey + RowsPerBucket - 1)/RowsPerBucket;
+    Reset();
+}
+
+void FHexBlueNoiseSampler::Reset()
+{
+    BucketFirst.Init(-1, BucketColumns*BucketRows);
+    SampleNext.Reset();
+    SampleTiles.Reset();
+}
+
+//Looks through the buckets next to the tile's, which hold every sample close enough to matter
+bool FHexBlueNoiseSampler::HasSampleCloserThan(int32 index, float distance) const
+{
+    int32 halfColumn=getHalfColumn(index);
+    int32 y=index/mapsizex;
+    int32 bucketColumn=halfColumn*BucketColumns/(2*mapsizex);
+    int32 bucketRow=y/RowsPerBucket;
+    //Squared distances, times 4 so that they are integers : (2*dpx)^2 + 3*dy^2
+    float limit=4.f*distance*distance;
+
+    //With less than 3 bucket columns, every column is next to every other one
+    int32 firstColumn=(BucketColumns >= 3) ? bucketColumn - 1 : 0;
+    int32 numberOfColumns=FMath::Min(BucketColumns, 3);
+    for (int32 row=FMath::Max(bucketRow-1, 0); row<=FMath::Min(bucketRow+1, BucketRows-1); row++) {
+        for (int32 k=0; k<numberOfColumns; k++) {
+            int32 column=(firstColumn + k + BucketColumns) % BucketColumns;
+            for (int32 sample=BucketFirst[row*BucketColumns + column]; sample!=-1; sample=SampleNext[sample]) {
+                int32 other=SampleTiles[sample];
+                int32 dx=halfColumn - getHalfColumn(other);
+                //Shortest way around the cylinder
+                if (dx > mapsizex) {
+                    dx-=2*mapsizex;
+                }
+                else if (dx < -mapsizex) {
+                    dx+=2*mapsizex;
+                }
+                int32 dy=y - other/mapsizex;
+                if ((float)(dx*dx + 3*dy*dy) < limit) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void FHexBlueNoiseSampler::AddSample(int32 index)
+{
+    int32 bucket=getBucket(getHalfColumn(index), index/mapsizex);
+    SampleNext.Add(BucketFirst[bucket]);
+    BucketFirst[bucket]=SampleTiles.Add(index);
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "C_MapRandom.h"
+
+/**
+ * Blue noise (Poisson disk) sampling of tiles of the hex map : samples are spread out evenly, with no two samples closer than a given spacing,
+ * which can change from tile to tile to follow a density. Used to place forests, and meant to place anything else that should not clump (resources...).
+ * Distances are taken between tile centers on the hex lattice (px = x + y/2, py = y*sqrt(3)/2), around the cylinder; neighbors are 1 apart.
+ * Kept samples go in a spatial hash : a grid of buckets at least as wide and as high as the biggest spacing, wrapped around the cylinder,
+ * so every candidate only looks at the samples of the 3x3 buckets around it and the cost grows linearly with the number of candidates.
+ */
+class TWELVEANGRYNODES_API FHexBlueNoiseSampler
+{
+public:
+
+    //maxSpacing is the biggest spacing any tile will ask for, in tiles
+    FHexBlueNoiseSampler(int32 inMapsizex, int32 inMapsizey, float maxSpacing);
+
+    /*Goes through the candidate tiles in a random order, taken from 'random', and keeps every tile with no sample closer than spacing(tile).
+     Tiles with a spacing of 1 or less are always kept, tiles with a spacing of 0 or less, or above maxSpacing, are never kept.
+     Samples of earlier calls are kept as well, so several calls with different candidates share their spacing. Kept tiles are added to outSamples.
+     */
+    template<typename SpacingType>
+    void Sample(const TArray<int32>& candidates, FMapRandomStream& random, SpacingType spacing, TArray<int32>& outSamples)
+    {
+        //Fisher-Yates shuffle, one draw per candidate
+        TArray<int32> order(candidates);
+        for (int32 i=order.Num()-1; i>0; i--) {
+            int32 j=random.RandRange(0, i);
+            int32 tile=order[i];
+            order[i]=order[j];
+            order[j]=tile;
+        }
+        for (int32 i=0; i<order.Num(); i++) {
+            float tileSpacing=spacing(order[i]);
+            if ((tileSpacing > 0.f) && (tileSpacing <= MaxSpacing) && !HasSampleCloserThan(order[i], tileSpacing)) {
+                AddSample(order[i]);
+                outSamples.Add(order[i]);
+            }
+        }
+    }
+
+    //Forgets every sample taken so far
+    void Reset();
+
+private:
+
+    //Place of a tile around the cylinder, doubled so that it is an integer : 2*px, in [0, 2*mapsizex)
+    FORCEINLINE int32 getHalfColumn(int32 index) const
+    {
+        return (2*(index % mapsizex) + index/mapsizex) % (2*mapsizex);
+    }
+
+    FORCEINLINE int32 getBucket(int32 halfColumn, int32 y) const
+    {
+        return (y/RowsPerBucket)*BucketColumns + halfColumn*BucketColumns/(2*mapsizex);
+    }
+
+    bool HasSampleCloserThan(int32 index, float distance) const;
+    void AddSample(int32 index);
+
+    int32 mapsizex;
+    int32 mapsizey;
+    float MaxSpacing;
+    //Every bucket is at least MaxSpacing wide and high
+    int32 BucketColumns;
+    int32 BucketRows;
+    int32 RowsPerBucket;
+    //First sample of every bucket, and next sample of the same bucket for every sample, -1 ending the lists
+    TArray<int32> BucketFirst;
+    TArray<int32> SampleNext;
+    TArray<int32> SampleTiles;
+};
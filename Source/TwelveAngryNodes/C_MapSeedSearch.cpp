@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "Async/ParallelFor.h"
+#include "C_MapGenerator.h"
+
+/*
+ Seed search : maps for tournaments and balance testing, generated headless in batches and kept only if they meet the SeedConstraints of the generator.
+ Like the benchmarks, it only spawns transient generators (no hexes), so it can be run from a commandlet-like session :
+ UE4Editor-Cmd TwelveAngryNodes.uproject -game -nullrhi -ExecCmds="tan.SearchSeeds,quit"
+ */
+
+//Kept maps are ranked on the fairness of their starts, the share of the asked rivers which could be placed only breaking near ties
+static const float SeedRiverScoreWeight = 0.1f;
+
+/*Generators are actors, so they are spawned in a world, never made with NewObject.
+ The spawned class is always the native one : a blueprint subclass could run its own BeginPlay (and generate or spawn hexes). The settings are copied over instead of used as a
+ template, which has to be of the spawned class; only the properties declared by AC_MapGenerator are copied, not the actor ones (root component, tags...).
+ */
+AC_MapGenerator* AC_MapGenerator::SpawnTransientGenerator(UWorld* world, const AC_MapGenerator* settings)
+{
+    if (world == nullptr) {
+        return nullptr;
+    }
+    FActorSpawnParameters parameters;
+    parameters.ObjectFlags|=RF_Transient;
+    parameters.SpawnCollisionHandlingOverride=ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    AC_MapGenerator* generator=world->SpawnActor<AC_MapGenerator>(parameters);
+    if ((generator != nullptr) && (settings != nullptr)) {
+        for (TFieldIterator<UProperty> property(AC_MapGenerator::StaticClass(), EFieldIteratorFlags::ExcludeSuper); property; ++property) {
+            property->CopyCompleteValue_InContainer(generator, settings);
+        }
+    }
+    return generator;
+}
+
+/*Runs function(worker, i) for every i from 0 to count-1 on a pool of workers, one generator per task graph thread (and one for the calling thread).
+ The workers are spawned here on the game thread, in the world of this generator and with its settings, and destroyed once every index is done; in between, they only run
+ the stages of their own generator.
+ Generations cost very different times (rejected seeds stop early), so every worker takes the next index once it is free instead of a fixed share of them.
+ Returns the number of workers; 0 if nothing ran : the workers would be copies of this generator, which a running generation is still writing to, or there is no world to spawn them in.
+ */
+int32 AC_MapGenerator::ForEachSeedOnWorkers(int32 count, TFunction<void(AC_MapGenerator*, int32)> function)
+{
+    if (IsGeneratingMap() || (count <= 0)) {
+        return 0;
+    }
+    if (GetWorld() == nullptr) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("%s is in no world, so no worker generator can be spawned"), *GetName());
+        return 0;
+    }
+    int32 numberOfWorkers=FMath::Clamp(FTaskGraphInterface::Get().GetNumWorkerThreads()+1, 1, count);
+    TArray<AC_MapGenerator*> workers;
+    for (int32 i=0; i<numberOfWorkers; i++) {
+        AC_MapGenerator* worker=SpawnTransientGenerator(GetWorld(), this);
+        if (worker != nullptr) {
+            workers.Add(worker);
+        }
+    }
+    if (workers.Num() == 0) {
+        return 0;
+    }
+    FThreadSafeCounter next(0);
+    ParallelFor(workers.Num(), [&workers, &next, &function, count](int32 w) {
+        for (int32 i=next.Increment()-1; i<count; i=next.Increment()-1) {
+            function(workers[w], i);
+        }
+    });
+    for (AC_MapGenerator* worker : workers) {
+        worker->Destroy();
+    }
+    return workers.Num();
+}
+
+TArray<FMapSeedResult> AC_MapGenerator::SearchSeeds(int32 firstSeed, int32 numberOfCandidates, int32 numberOfResults, int32 numberOfRivers)
+{
+    TArray<FMapSeedResult> kept;
+    if (numberOfResults <= 0) {
+        return kept;
+    }
+    double start=FPlatformTime::Seconds();
+
+    TArray<FMapSeedResult> results;
+    results.SetNum(FMath::Max(numberOfCandidates, 0));
+    TArray<uint8> passed;
+    passed.SetNumZeroed(FMath::Max(numberOfCandidates, 0));
+    int32 numberOfWorkers=ForEachSeedOnWorkers(numberOfCandidates, [&results, &passed, firstSeed, numberOfRivers](AC_MapGenerator* worker, int32 i) {
+        //Seed 0 stands for a time based seed, so it is skipped
+        if (firstSeed+i == 0) {
+            return;
+        }
+        worker->Seed=firstSeed+i;
+        passed[i]=worker->EvaluateSeed(numberOfRivers, results[i]) ? 1 : 0;
+    });
+    if (numberOfWorkers == 0) {
+        return kept;
+    }
+
+    for (int32 i=0; i<numberOfCandidates; i++) {
+        if (passed[i] != 0) {
+            kept.Add(results[i]);
+        }
+    }
+    int32 numberKept=kept.Num();
+    kept.Sort([](const FMapSeedResult& a, const FMapSeedResult& b) {
+        return (a.Score > b.Score) || ((a.Score == b.Score) && (a.Seed < b.Seed));
+    });
+    if (kept.Num() > numberOfResults) {
+        kept.SetNum(numberOfResults);
+    }
+    UE_LOG(LogMapGeneration, Log, TEXT("Seed search %dx%d : %d of the %d seeds from %d kept, %d workers, %.2f s"),
+           mapsizex, mapsizey, numberKept, numberOfCandidates, firstSeed, numberOfWorkers, FPlatformTime::Seconds()-start);
+    return kept;
+}
+
+//Generates the map of Seed, stopping as soon as it fails one of the SeedConstraints; returns true if it meets all of them
+//The land share is checked once the terrain stage is done (only the altitude stages ran before it), and the rivers once they are built
+//The generation data is released afterwards, only the per tile arrays are kept for the next seed
+bool AC_MapGenerator::EvaluateSeed(int32 numberOfRivers, FMapSeedResult& outResult)
+{
+    outResult=FMapSeedResult();
+    outResult.Seed=Seed;
+
+    TSharedPtr<FMapGenerationPipeline> pipeline=BuildGenerationPipeline(numberOfRivers);
+    FMapGenerationPipeline* run=pipeline.Get();
+    pipeline->SetStageDoneCallback([this, run, &outResult](const FMapGenerationStage& stage) {
+        if (stage.Name == TEXT("Terrain")) {
+            outResult.LandShare=(float)LandTiles.Num()/(mapsizex*mapsizey);
+            if ((outResult.LandShare < SeedConstraints.MinLandShare) || (outResult.LandShare > SeedConstraints.MaxLandShare)) {
+                run->RequestCancel();
+            }
+        }
+        else if (stage.Name == TEXT("Rivers")) {
+            outResult.Rivers=CountRiverMouths();
+            if (outResult.Rivers < SeedConstraints.MinRivers) {
+                run->RequestCancel();
+            }
+        }
+    });
+    bool passed=pipeline->Run();
+
+    if (passed) {
+        passed=(StartingSpots.Num() >= FMath::Max(NumberOfCivs, 1));
+    }
+    if (passed) {
+        int32 worstScore=StartSpotScores[0];
+        int32 bestScore=StartSpotScores[0];
+        for (int32 i=1; i<StartSpotScores.Num(); i++) {
+            worstScore=FMath::Min(worstScore, StartSpotScores[i]);
+            bestScore=FMath::Max(bestScore, StartSpotScores[i]);
+        }
+        outResult.StartFairness=(bestScore > 0) ? (float)worstScore/bestScore : 0.f;
+        passed=(outResult.StartFairness >= SeedConstraints.MinStartFairness);
+    }
+    if (passed) {
+        TArray<uint8> isLand;
+        isLand.SetNumZeroed(mapsizex*mapsizey);
+        for (int32 i=0; i<LandTiles.Num(); i++) {
+            isLand[LandTiles[i]]=1;
+        }
+        TArray<int32> landmassOfTile, landmassSizes;
+        NeighborTable->LabelComponents([&isLand](int32 i) {return isLand[i] != 0;}, landmassOfTile, landmassSizes);
+        for (int32 i=0; (i<StartingSpots.Num()) && passed; i++) {
+            passed=(landmassSizes[landmassOfTile[StartingSpots[i]]] >= SeedConstraints.MinStartLandmass);
+        }
+    }
+    if (passed) {
+        float riverShare=(numberOfRivers > 0) ? FMath::Min((float)outResult.Rivers/numberOfRivers, 1.f) : 1.f;
+        outResult.Score=outResult.StartFairness + SeedRiverScoreWeight*riverShare;
+    }
+
+    ReleaseGenerationData();
+    return passed;
+}
+
+//Rivers are counted by their mouths : segments whose segStart marks a start from the sea (0) or a lake (4), or from a waterfall (3) dropping into water.
+//Forks (1) and cascades (2) never start from water; climbing waterfalls start downstream from the land tile the river came through
+int32 AC_MapGenerator::CountRiverMouths()
+{
+    int32 mouths=0;
+    for (int32 i=0; i<Rivers.Num(); i++) {
+        int32 start=Rivers[i]->segStart;
+        if ((start == 0) || (start == 4)) {
+            mouths++;
+        }
+        else if (start == 3) {
+            int32 water=getNeighbor(Rivers[i]->LeftBank[0], Rivers[i]->dir[0]-1);
+            if ((water != -1) && ((TerrainType[water] == ETerrain::VE_Coast) || (TerrainType[water] == ETerrain::VE_Ocean) || (TerrainType[water] == ETerrain::VE_Lake))) {
+                mouths++;
+            }
+        }
+    }
+    return mouths;
+}
+
+
+static void SearchSeedsOnDefaultMap(UWorld* world)
+{
+    AC_MapGenerator* generator=AC_MapGenerator::SpawnTransientGenerator(world, nullptr);
+    if (generator == nullptr) {
+        UE_LOG(LogMapGeneration, Warning, TEXT("tan.SearchSeeds needs a world to spawn its generators in"));
+        return;
+    }
+    generator->mapsizex=128;
+    generator->mapsizey=81;
+    generator->bUseMapCache=false;
+
+    TArray<FMapSeedResult> best=generator->SearchSeeds(1, 64, 5, 40);
+    for (int32 i=0; i<best.Num(); i++) {
+        UE_LOG(LogMapGeneration, Display, TEXT("Seed %d : score %.3f, land share %.2f, %d rivers, start fairness %.2f"),
+               best[i].Seed, best[i].Score, best[i].LandShare, best[i].Rivers, best[i].StartFairness);
+    }
+    generator->Destroy();
+}
+
+static FAutoConsoleCommandWithWorld SearchSeedsCommand(
+    TEXT("tan.SearchSeeds"),
+    TEXT("Generates the 128x81 maps of seeds 1 to 64 and logs the 5 best ones meeting the default seed constraints"),
+    FConsoleCommandWithWorldDelegate::CreateStatic(&SearchSeedsOnDefaultMap));
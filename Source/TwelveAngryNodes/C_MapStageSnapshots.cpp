@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_MapGenerator.h"
+
+/*
+ Incremental generation : with bIncrementalGeneration, every stage leaves a copy of what it wrote (its channels, see EMapChannel) along with the checksum of its parameters.
+ The next generation only runs from the first stage whose parameters changed, after putting back, channel by channel, what the last stage before it writing the channel left.
+ Every stage draws from its own random streams (see FMapRandom), so the map is the same as a full generation with the new parameters.
+ */
+
+//Calls function(channel, array) on every array holding data of the channels, always in the same order; lakes and river segments live in the generation arena, so they are dealt with apart
+template<typename FunctionType>
+void AC_MapGenerator::ForEachChannelArray(EMapChannel channels, FunctionType function)
+{
+    typedef EMapChannel C;
+    if (EnumHasAnyFlags(channels, C::Altitude)) {
+        function(C::Altitude, AltitudeMap);
+    }
+    if (EnumHasAnyFlags(channels, C::Terrain)) {
+        function(C::Terrain, TerrainType);
+        function(C::Terrain, Moisture);
+    }
+    if (EnumHasAnyFlags(channels, C::Lakes)) {
+        function(C::Lakes, WaterBodyOfTile);
+        function(C::Lakes, WaterBodySizes);
+        function(C::Lakes, LakeOfTile);
+    }
+    if (EnumHasAnyFlags(channels, C::TileLists)) {
+        function(C::TileLists, LandTiles);
+        function(C::TileLists, WaterTiles);
+    }
+    if (EnumHasAnyFlags(channels, C::Rivers)) {
+        function(C::Rivers, LeftBankCount);
+        function(C::Rivers, RightBankCount);
+        function(C::Rivers, RiverEdges);
+    }
+    if (EnumHasAnyFlags(channels, C::FreshWater)) {
+        function(C::FreshWater, freshWater);
+    }
+    if (EnumHasAnyFlags(channels, C::HexTypes)) {
+        function(C::HexTypes, RampType);
+        function(C::HexTypes, CoastType);
+        function(C::HexTypes, OceanCoastType);
+        function(C::HexTypes, RampRotation);
+        function(C::HexTypes, CoastRotation);
+    }
+    if (EnumHasAnyFlags(channels, C::Forests)) {
+        function(C::Forests, Forests);
+    }
+    if (EnumHasAnyFlags(channels, C::Resources)) {
+        function(C::Resources, resources);
+        function(C::Resources, resourceRotations);
+    }
+    if (EnumHasAnyFlags(channels, C::Improvements)) {
+        function(C::Improvements, improvements);
+    }
+    if (EnumHasAnyFlags(channels, C::StartingSpots)) {
+        function(C::StartingSpots, StartingSpots);
+        function(C::StartingSpots, StartSpotScores);
+    }
+    if (EnumHasAnyFlags(channels, C::Distances)) {
+        for (int32 i=0; i<NumberOfMapDistances; i++) {
+            function(C::Distances, DistanceFields[i]);
+        }
+    }
+    if (EnumHasAnyFlags(channels, C::Regions)) {
+        function(C::Regions, StartRegionSeeds);
+        function(C::Regions, StartRegionOfTile);
+    }
+}
+
+//Finds the first stage to run, puts back the output of the stages before it, and has the pipeline take the snapshots of the stages it runs
+void AC_MapGenerator::PrepareIncrementalGeneration(FMapGenerationPipeline& pipeline)
+{
+    //A time based seed changes every stage
+    if (!bIncrementalGeneration || (Seed == 0)) {
+        StageSnapshots.Empty();
+        return;
+    }
+    const TArray<FMapGenerationStage>& stages=pipeline.GetStages();
+    StageSnapshots.SetNum(stages.Num());
+    int32 firstStage=0;
+    while ((firstStage < stages.Num()) && StageSnapshots[firstStage].bValid && (StageSnapshots[firstStage].ParametersHash == stages[firstStage].ParametersHash)) {
+        firstStage++;
+    }
+    //The snapshots from there on are taken again as the stages run; a cancelled generation leaves the remaining ones invalid
+    for (int32 i=firstStage; i<stages.Num(); i++) {
+        StageSnapshots[i].bValid=false;
+    }
+    RestoreStageSnapshots(stages, firstStage);
+    pipeline.SetFirstStage(firstStage);
+    pipeline.SetStageDoneCallback([this](const FMapGenerationStage& stage) {
+        SaveStageSnapshot(stage);
+    });
+}
+
+//Runs on the thread of the stage; no other stage uses its channels meanwhile, and every stage has its own snapshot
+void AC_MapGenerator::SaveStageSnapshot(const FMapGenerationStage& stage)
+{
+    FMapStageSnapshot& snapshot=StageSnapshots[stage.Index];
+    snapshot.Arrays.Reset();
+    ForEachChannelArray(stage.Writes, [&snapshot](EMapChannel channel, auto& values) {
+        TArray<uint8>& bytes=snapshot.Arrays[snapshot.Arrays.AddDefaulted()];
+        bytes.SetNumUninitialized(values.Num()*values.GetTypeSize());
+        FMemory::Memcpy(bytes.GetData(), values.GetData(), bytes.Num());
+    });
+    snapshot.Lakes.Reset();
+    if (EnumHasAnyFlags(stage.Writes, EMapChannel::Lakes)) {
+        for (int32 i=0; i<Lakes.Num(); i++) {
+            snapshot.Lakes.Add(*Lakes[i]);
+        }
+    }
+    snapshot.Rivers.Reset();
+    if (EnumHasAnyFlags(stage.Writes, EMapChannel::Rivers)) {
+        for (int32 i=0; i<Rivers.Num(); i++) {
+            snapshot.Rivers.Add(*Rivers[i]);
+        }
+    }
+    snapshot.ParametersHash=stage.ParametersHash;
+    snapshot.bValid=true;
+}
+
+//Every channel comes back from the last stage before firstStage writing it; the channels none of them writes start empty, as in a full generation
+//Expects the generation data to be released (see BuildGenerationPipeline)
+void AC_MapGenerator::RestoreStageSnapshots(const TArray<FMapGenerationStage>& stages, int32 firstStage)
+{
+    EMapChannel restored=EMapChannel::None;
+    for (int32 i=firstStage-1; i>=0; i--) {
+        EMapChannel channels=stages[i].Writes & ~restored;
+        const FMapStageSnapshot& snapshot=StageSnapshots[i];
+        int32 next=0;
+        ForEachChannelArray(stages[i].Writes, [&snapshot, &next, channels](EMapChannel channel, auto& values) {
+            const TArray<uint8>& bytes=snapshot.Arrays[next++];
+            if (EnumHasAnyFlags(channels, channel)) {
+                values.SetNumUninitialized(bytes.Num()/values.GetTypeSize());
+                FMemory::Memcpy(values.GetData(), bytes.GetData(), bytes.Num());
+            }
+        });
+        if (EnumHasAnyFlags(channels, EMapChannel::Lakes)) {
+            for (int32 j=0; j<snapshot.Lakes.Num(); j++) {
+                Lakes.Add(GenerationArena.New<WaterBody>(snapshot.Lakes[j]));
+            }
+        }
+        if (EnumHasAnyFlags(channels, EMapChannel::Rivers)) {
+            for (int32 j=0; j<snapshot.Rivers.Num(); j++) {
+                Rivers.Add(GenerationArena.New<RiverSegment>(snapshot.Rivers[j]));
+            }
+        }
+        restored|=channels;
+    }
+    ForEachChannelArray(~restored, [](EMapChannel channel, auto& values) {
+        values.Empty();
+    });
+}
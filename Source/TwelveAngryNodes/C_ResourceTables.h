@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+ Lookup table used by AC_MapGenerator::PlaceResources : where every resource (quarries aside, which depend on cliffs) can be placed, and how often.
+ Deep ocean gets no resources.
+ A resource of a family is picked among the rules of that family fitting the tile, with a chance proportional to its weight.
+ Strategic and luxury resources are the ones the start regions get a quota of.
+ */
+
+static constexpr uint16 ResourceTerrainBit(ETerrain terrain)
+{
+    return (uint16)(1 << (uint32)terrain);
+}
+
+static constexpr uint16 ResourceAnyLand = ResourceTerrainBit(ETerrain::VE_Marsh) | ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain)
+    | ResourceTerrainBit(ETerrain::VE_Tundra) | ResourceTerrainBit(ETerrain::VE_Snow) | ResourceTerrainBit(ETerrain::VE_Desert);
+
+//Rule flags
+static constexpr uint8 ResourceNeedsForest = 1;
+static constexpr uint8 ResourceNoForest = 2;
+static constexpr uint8 ResourceNeedsFreshWater = 4;
+static constexpr uint8 ResourceStrategic = 8;
+static constexpr uint8 ResourceLuxury = 16;
+
+struct FResourceRule
+{
+    EResource Resource;
+    EImprovement Family;
+    uint16 Terrains;    //ResourceTerrainBit of every terrain the resource can be on
+    uint8 Flags;
+    int32 Weight;
+};
+
+static const FResourceRule ResourceRules[] = {
+    //Mines, on any land (weights out of 19)
+    {EResource::VE_Copper, EImprovement::VE_Mine, ResourceAnyLand, ResourceStrategic, 4},
+    {EResource::VE_Iron, EImprovement::VE_Mine, ResourceAnyLand, ResourceStrategic, 2},
+    {EResource::VE_Mithril, EImprovement::VE_Mine, ResourceAnyLand, ResourceStrategic, 1},
+    {EResource::VE_Gems, EImprovement::VE_Mine, ResourceAnyLand, ResourceLuxury, 4},
+    {EResource::VE_Gold, EImprovement::VE_Mine, ResourceAnyLand, ResourceLuxury, 4},
+    {EResource::VE_Silver, EImprovement::VE_Mine, ResourceAnyLand, ResourceLuxury, 4},
+    //Plantations
+    {EResource::VE_Cotton, EImprovement::VE_Plantation, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest | ResourceLuxury, 3},
+    {EResource::VE_Spices, EImprovement::VE_Plantation, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Marsh), ResourceLuxury, 2},
+    {EResource::VE_Sugar, EImprovement::VE_Plantation, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Marsh), ResourceNoForest | ResourceLuxury, 2},
+    {EResource::VE_Wine, EImprovement::VE_Plantation, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest | ResourceLuxury, 2},
+    //Pastures
+    {EResource::VE_Cattle, EImprovement::VE_Pasture, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest, 4},
+    {EResource::VE_Horses, EImprovement::VE_Pasture, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Tundra), ResourceNoForest | ResourceStrategic, 3},
+    {EResource::VE_Sheep, EImprovement::VE_Pasture, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Tundra), ResourceNoForest, 3},
+    //Camps
+    {EResource::VE_Deer, EImprovement::VE_Camp, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Tundra), 0, 4},
+    {EResource::VE_Furs, EImprovement::VE_Camp, ResourceTerrainBit(ETerrain::VE_Tundra) | ResourceTerrainBit(ETerrain::VE_Snow), ResourceLuxury, 3},
+    {EResource::VE_Ivory, EImprovement::VE_Camp, ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Desert), ResourceNoForest | ResourceLuxury, 2},
+    //Farms
+    {EResource::VE_Barley, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Tundra), ResourceNoForest, 3},
+    {EResource::VE_Beans, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest, 2},
+    {EResource::VE_Corn, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest, 3},
+    {EResource::VE_Rice, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Marsh), ResourceNoForest | ResourceNeedsFreshWater, 2},
+    {EResource::VE_Tomato, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Grassland), ResourceNoForest, 2},
+    {EResource::VE_Wheat, EImprovement::VE_Farm, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain), ResourceNoForest, 3},
+    //Lumbermills
+    {EResource::VE_Hardwood, EImprovement::VE_Lumbermill, ResourceTerrainBit(ETerrain::VE_Grassland) | ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Marsh), ResourceNeedsForest, 3},
+    {EResource::VE_Pine, EImprovement::VE_Lumbermill, ResourceTerrainBit(ETerrain::VE_Plain) | ResourceTerrainBit(ETerrain::VE_Tundra), ResourceNeedsForest, 2},
+    //Fishing boats
+    {EResource::VE_Fish, EImprovement::VE_FishingBoat, ResourceTerrainBit(ETerrain::VE_Coast) | ResourceTerrainBit(ETerrain::VE_Lake), 0, 4},
+    {EResource::VE_Crabs, EImprovement::VE_FishingBoat, ResourceTerrainBit(ETerrain::VE_Coast), 0, 2},
+    {EResource::VE_Pearls, EImprovement::VE_FishingBoat, ResourceTerrainBit(ETerrain::VE_Coast), ResourceLuxury, 1},
+    {EResource::VE_Whales, EImprovement::VE_FishingBoat, ResourceTerrainBit(ETerrain::VE_Coast), ResourceLuxury, 1},
+};
+static const int32 NumberOfResourceRules = sizeof(ResourceRules)/sizeof(ResourceRules[0]);
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TwelveAngryNodes.h"
+#include "C_WorldFile.h"
+
+//Values are written and read as they are in memory
+#if !PLATFORM_LITTLE_ENDIAN
+#error World files are little endian; big endian platforms need byte swapping in FWorldFileWriter and FWorldFile
+#endif
+
+static FORCEINLINE int64 AlignWorldOffset(int64 offset)
+{
+    return (offset + WorldFileAlignment - 1) & ~(WorldFileAlignment - 1);
+}
+
+FWorldFileWriter::FWorldFileWriter(int32 inMapsizex, int32 inMapsizey, int32 inSeed, uint32 inParametersHash)
+{
+    FMemory::Memzero(&Header, sizeof(Header));
+    Header.Magic=WorldFileMagic;
+    Header.Version=WorldFileVersion;
+    Header.mapsizex=inMapsizex;
+    Header.mapsizey=inMapsizey;
+    Header.Seed=inSeed;
+    Header.ParametersHash=inParametersHash;
+}
+
+void FWorldFileWriter::AddSection(EWorldSection id, const void* data, uint32 elementSize, int64 count)
+{
+    FWorldFileSection section;
+    section.Id=(uint32)id;
+    section.ElementSize=elementSize;
+    section.Offset=AlignWorldOffset(Payload.Num());
+    section.Count=count;
+    Sections.Add(section);
+
+    Payload.AddZeroed((int32)(section.Offset + elementSize*count - Payload.Num()));
+    if (count > 0) {
+        FMemory::Memcpy(Payload.GetData()+section.Offset, data, elementSize*count);
+    }
+}
+
+bool FWorldFileWriter::SaveToFile(const FString& path) const
+{
+    int64 dataStart=AlignWorldOffset(sizeof(FWorldFileHeader) + Sections.Num()*sizeof(FWorldFileSection));
+
+    TArray<uint8> file;
+    file.AddZeroed((int32)(dataStart + Payload.Num()));
+
+    FWorldFileHeader header=Header;
+    header.NumSections=Sections.Num();
+    header.FileSize=file.Num();
+    FMemory::Memcpy(file.GetData(), &header, sizeof(header));
+
+    FWorldFileSection* table=(FWorldFileSection*)(file.GetData()+sizeof(FWorldFileHeader));
+    for (int32 i=0; i<Sections.Num(); i++) {
+        table[i]=Sections[i];
+        table[i].Offset+=dataStart;
+    }
+    if (Payload.Num() > 0) {
+        FMemory::Memcpy(file.GetData()+dataStart, Payload.GetData(), Payload.Num());
+    }
+    return FFileHelper::SaveArrayToFile(file, *path);
+}
+
+FWorldFile::FWorldFile()
+{
+    FMemory::Memzero(&Header, sizeof(Header));
+    for (int32 i=0; i<(int32)EWorldSection::Count; i++) {
+        SectionIndex[i]=-1;
+    }
+}
+
+bool FWorldFile::LoadFromFile(const FString& path)
+{
+    TSharedPtr<TArray<uint8>> fileBuffer=MakeShareable(new TArray<uint8>());
+    if (!FFileHelper::LoadFileToArray(*fileBuffer, *path, FILEREAD_Silent)) {
+        return false;
+    }
+    return LoadFromBuffer(fileBuffer);
+}
+
+//Checks the header and every section once, so that sections can then be used without any further check
+bool FWorldFile::LoadFromBuffer(const TSharedPtr<TArray<uint8>>& inBuffer)
+{
+    if (!inBuffer.IsValid() || (inBuffer->Num() < (int32)sizeof(FWorldFileHeader))) {
+        return false;
+    }
+    FWorldFileHeader header;
+    FMemory::Memcpy(&header, inBuffer->GetData(), sizeof(header));
+    int64 fileSize=inBuffer->Num();
+    if ((header.Magic!=WorldFileMagic) || (header.Version!=WorldFileVersion) || (header.FileSize!=(uint64)fileSize)
+        || (header.mapsizex<=0) || (header.mapsizey<=0)
+        || ((int64)sizeof(FWorldFileHeader) + (int64)header.NumSections*sizeof(FWorldFileSection) > fileSize)) {
+        return false;
+    }
+
+    int32 sectionIndex[(int32)EWorldSection::Count];
+    for (int32 i=0; i<(int32)EWorldSection::Count; i++) {
+        sectionIndex[i]=-1;
+    }
+    const FWorldFileSection* table=(const FWorldFileSection*)(inBuffer->GetData()+sizeof(FWorldFileHeader));
+    for (uint32 i=0; i<header.NumSections; i++) {
+        const FWorldFileSection& section=table[i];
+        if ((section.Offset % WorldFileAlignment != 0) || (section.Offset > (uint64)fileSize)
+            || (section.ElementSize==0) || (section.Count > (uint64)(fileSize - section.Offset)/section.ElementSize)) {
+            return false;
+        }
+        if (section.Id < (uint32)EWorldSection::Count) {
+            sectionIndex[section.Id]=i;
+        }
+    }
+
+    Header=header;
+    Buffer=inBuffer;
+    FMemory::Memcpy(SectionIndex, sectionIndex, sizeof(SectionIndex));
+    return true;
+}
+
+const FWorldFileSection* FWorldFile::FindSection(EWorldSection id) const
+{
+    int32 index=SectionIndex[(int32)id];
+    if (index==-1) {
+        return nullptr;
+    }
+    return ((const FWorldFileSection*)(Buffer->GetData()+sizeof(FWorldFileHeader)))+index;
+}
+
+int64 FWorldFile::GetSectionOffset(EWorldSection id) const
+{
+    const FWorldFileSection* section=FindSection(id);
+    return (section!=nullptr) ? (int64)section->Offset : -1;
+}
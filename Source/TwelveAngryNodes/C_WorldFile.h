@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+ WORLD FILE FORMAT (little endian, version WorldFileVersion) :
+
+ FWorldFileHeader
+ FWorldFileSection x NumSections
+ padding to 64 bytes
+ sections, each one starting on a 64 byte boundary
+
+ Every section is a flat array of ElementSize byte values, laid out exactly as in memory, so that a loaded file is used in place :
+ the tile records are handed to the game as they are (see FHexTileStore::AttachToBuffer), and the other arrays are single copies.
+ */
+
+//Sections of a world file; new sections go at the end, and readers ignore the ones they don't know
+enum class EWorldSection : uint32
+{
+    TileRecords,        //uint32 per tile, see FHexTileStore
+    Altitude,           //int32 per tile
+    Terrain,            //ETerrain per tile
+    RiverEdges,         //uint8 per tile, bit dir-1 set when there is a river on the 'dir' side
+    Forests,            //int32 per tile
+    FreshWater,         //int32 per tile
+    Resources,          //EResource per tile
+    ResourceRotations,  //int32 per tile
+    Improvements,       //EImprovement per tile
+    RampTypes,          //int32 per tile
+    RampRotations,      //int32 per tile
+    CoastTypes,         //int32 per tile
+    CoastRotations,     //int32 per tile
+    OceanCoastTypes,    //int32 per tile
+    LandTiles,          //int32 tile indexes
+    WaterTiles,         //int32 tile indexes
+    StartingSpots,      //int32 tile indexes
+    Lakes,              //FWorldLake per lake
+    LakeTiles,          //int32 tile indexes, referenced by the lakes
+    RiverSegments,      //FWorldRiverSegment per segment
+    RiverBanks,         //FWorldRiverBank, referenced by the segments
+    Count
+};
+
+static const uint32 WorldFileMagic = 0x444C5754;//"TWLD"
+static const uint32 WorldFileVersion = 1;
+static const int64 WorldFileAlignment = 64;
+
+struct FWorldFileHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    int32 mapsizex;
+    int32 mapsizey;
+    int32 Seed;
+    //Checksum of the generation parameters, for caches
+    uint32 ParametersHash;
+    uint32 NumSections;
+    uint32 Reserved;
+    uint64 FileSize;
+};
+
+struct FWorldFileSection
+{
+    uint32 Id;
+    uint32 ElementSize;
+    //From the start of the file
+    uint64 Offset;
+    uint64 Count;
+};
+
+struct FWorldLake
+{
+    int32 FirstTile;
+    int32 NumTiles;
+    int32 Altitude;
+    int32 Reserved;
+};
+
+struct FWorldRiverSegment
+{
+    int32 FirstBank;
+    int32 NumBanks;
+    int32 Length;
+    int32 Altitude;
+    int32 Start;
+    int32 End;
+};
+
+struct FWorldRiverBank
+{
+    int32 Left;
+    int32 Right;
+    int32 Dir;
+};
+
+static_assert(sizeof(FWorldFileHeader)==40, "World file header layout changed");
+static_assert(sizeof(FWorldFileSection)==24, "World file section layout changed");
+
+/**
+ * Builds a world file in memory, section by section, and writes it with a single call.
+ */
+class TWELVEANGRYNODES_API FWorldFileWriter
+{
+public:
+
+    FWorldFileWriter(int32 inMapsizex, int32 inMapsizey, int32 inSeed, uint32 inParametersHash);
+
+    //Adds a section holding a copy of the values
+    void AddSection(EWorldSection id, const void* data, uint32 elementSize, int64 count);
+
+    template<typename ValueType>
+    void AddSection(EWorldSection id, const TArray<ValueType>& values)
+    {
+        AddSection(id, values.GetData(), sizeof(ValueType), values.Num());
+    }
+
+    bool SaveToFile(const FString& path) const;
+
+private:
+
+    FWorldFileHeader Header;
+    TArray<FWorldFileSection> Sections;
+    //Section data, with offsets relative to its start until the file is written
+    TArray<uint8> Payload;
+};
+
+/**
+ * A world file loaded with a single read into one buffer; sections are checked once on load, then accessed in place.
+ */
+class TWELVEANGRYNODES_API FWorldFile
+{
+public:
+
+    FWorldFile();
+
+    bool LoadFromFile(const FString& path);
+    //Takes a buffer holding a whole world file; returns false (and keeps nothing) if it isn't a valid one
+    bool LoadFromBuffer(const TSharedPtr<TArray<uint8>>& inBuffer);
+
+    FORCEINLINE const FWorldFileHeader& GetHeader() const
+    {
+        return Header;
+    }
+
+    FORCEINLINE const TSharedPtr<TArray<uint8>>& GetBuffer() const
+    {
+        return Buffer;
+    }
+
+    //Offset of a section in the buffer; -1 if the file doesn't have it
+    int64 GetSectionOffset(EWorldSection id) const;
+
+    //Returns the values of a section, or nullptr if the file doesn't have it or its values aren't ValueType sized
+    template<typename ValueType>
+    const ValueType* GetSectionData(EWorldSection id, int32& outCount) const
+    {
+        const FWorldFileSection* section=FindSection(id);
+        if ((section==nullptr) || (section->ElementSize!=sizeof(ValueType))) {
+            outCount=0;
+            return nullptr;
+        }
+        outCount=(int32)section->Count;
+        return (const ValueType*)(Buffer->GetData()+section->Offset);
+    }
+
+    //Copies the values of a section into an array; returns false if the section is missing
+    template<typename ValueType>
+    bool CopySection(EWorldSection id, TArray<ValueType>& outValues) const
+    {
+        int32 count=0;
+        const ValueType* values=GetSectionData<ValueType>(id, count);
+        if (values==nullptr) {
+            return false;
+        }
+        outValues.SetNumUninitialized(count);
+        FMemory::Memcpy(outValues.GetData(), values, count*sizeof(ValueType));
+        return true;
+    }
+
+private:
+
+    const FWorldFileSection* FindSection(EWorldSection id) const;
+
+    FWorldFileHeader Header;
+    TSharedPtr<TArray<uint8>> Buffer;
+    //Index in the section table of every known section, -1 if missing
+    int32 SectionIndex[(int32)EWorldSection::Count];
+};
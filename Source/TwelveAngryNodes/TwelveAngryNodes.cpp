@@ -3,3 +3,5 @@
 #include "TwelveAngryNodes.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, TwelveAngryNodes, "TwelveAngryNodes" );
+
+DEFINE_LOG_CATEGORY(LogMapGeneration);
@@ -4,3 +4,4 @@
 
 #include "Engine.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogMapGeneration, Log, All);